@@ -1,14 +1,63 @@
 #version 330
 
-uniform mat4 world;
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 time;
+};
 
+// the quadtree node being drawn, see TerrainChunk in terrain.h
+layout(std140) uniform Chunk {
+    vec4 node;     // x, z, size, level
+    vec4 morph;    // start, end
+};
+
+uniform sampler2D heightmap;
+uniform vec4 terrain;        // origin x, origin z, world size, height scale
+uniform vec4 terrainGrid;    // grid size, 1 / heightmap size
+
+// grid cells, y unused
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
 
 out vec4 vsColor;
 
+const vec3 lightDirection = vec3(0.267, -0.535, -0.802);
+
+vec2 worldPosition(vec2 cell)
+{
+    return node.xy + cell * (node.z / terrainGrid.x);
+}
+
+float heightAt(vec2 world)
+{
+    return texture(heightmap, (world - terrain.xy) / terrain.z).r * terrain.w;
+}
+
 void main()
 {
-    gl_Position = world * vec4(position, 1.0);
-    vsColor = vec4(color, 1.0);
+    // the rows and columns the next level doesn't have slide onto their
+    // even neighbours as the vertex nears the end of the range
+    vec3 eye = -(transpose(mat3(view)) * view[3].xyz);
+    vec2 xz = worldPosition(position.xz);
+    float d = length(eye - vec3(xz.x, heightAt(xz), xz.y));
+    float k = clamp((d - morph.x) / (morph.y - morph.x), 0.0, 1.0);
+
+    vec2 cell = position.xz - fract(position.xz * 0.5) * 2.0 * k;
+    xz = worldPosition(cell);
+    vec3 p = vec3(xz.x, heightAt(xz), xz.y);
+
+    // central differences one texel apart
+    float texel = terrain.z * terrainGrid.y;
+    vec3 n = normalize(vec3(heightAt(xz - vec2(texel, 0.0)) - heightAt(xz + vec2(texel, 0.0)),
+                            2.0 * texel,
+                            heightAt(xz - vec2(0.0, texel)) - heightAt(xz + vec2(0.0, texel))));
+
+    // grass on flat ground, rock on slopes, snow up high
+    float height = p.y / max(terrain.w, 1e-6);
+    vec3 color = mix(vec3(0.28, 0.45, 0.18), vec3(0.45, 0.40, 0.35), 1.0 - smoothstep(0.55, 0.75, n.y));
+    color = mix(color, vec3(0.95), smoothstep(0.7, 0.8, height) * smoothstep(0.6, 0.8, n.y));
+
+    gl_Position = viewProjection * vec4(p, 1.0);
+    vsColor = vec4(color * (0.25 + 0.75 * max(dot(n, -lightDirection), 0.0)), 1.0);
 }
@@ -0,0 +1,20 @@
+#version 330
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 time;
+};
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in mat4 world;
+
+out vec4 vsColor;
+
+void main()
+{
+    gl_Position = viewProjection * world * vec4(position, 1.0);
+    vsColor = color;
+}
@@ -0,0 +1,34 @@
+#version 330
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 time;
+};
+
+layout(std140) uniform Object {
+    mat4 world;
+};
+
+// positions may be stored relative to the mesh bounds, identity bounds
+// (center 0, extent 1) for absolute ones
+uniform vec4 boundsCenter;
+uniform vec4 boundsExtent;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 6) in vec3 normal;
+
+out vec4 vsColor;
+
+const vec3 lightDirection = vec3(0.267, 0.535, -0.802);
+
+void main()
+{
+    vec3 p = boundsCenter.xyz + position * boundsExtent.xyz;
+    vec3 n = normalize(mat3(world) * normal);
+
+    gl_Position = viewProjection * world * vec4(p, 1.0);
+    vsColor = vec4(color.rgb * (0.25 + 0.75 * max(dot(n, -lightDirection), 0.0)), color.a);
+}
@@ -0,0 +1,47 @@
+#version 330
+
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 time;
+};
+
+layout(std140) uniform Object {
+    mat4 world;
+};
+
+uniform vec4 boundsCenter;
+uniform vec4 boundsExtent;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+// octahedral encoded, see OctahedralEncode in vertex_format.cpp
+layout(location = 6) in vec2 normal;
+
+out vec4 vsColor;
+
+const vec3 lightDirection = vec3(0.267, 0.535, -0.802);
+
+vec2 SignNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 OctahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * SignNotZero(n.xy);
+
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 p = boundsCenter.xyz + position * boundsExtent.xyz;
+    vec3 n = normalize(mat3(world) * OctahedralDecode(normal));
+
+    gl_Position = viewProjection * world * vec4(p, 1.0);
+    vsColor = vec4(color.rgb * (0.25 + 0.75 * max(dot(n, -lightDirection), 0.0)), color.a);
+}
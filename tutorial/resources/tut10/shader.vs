@@ -1,14 +1,23 @@
 #version 330
 
-uniform mat4 world;
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 time;
+};
+
+layout(std140) uniform Object {
+    mat4 world;
+};
 
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
+layout(location = 1) in vec4 color;
 
 out vec4 vsColor;
 
 void main()
 {
-    gl_Position = world * vec4(position, 1.0);
-    vsColor = vec4(color, 1.0);
+    gl_Position = viewProjection * world * vec4(position, 1.0);
+    vsColor = color;
 }
@@ -19,6 +19,7 @@ float g_yAxis = 0.0f;
 float g_zAxis = 0.0f;
 
 static int g_world_uniform_loc;
+static int g_wireframe_world_uniform_loc;
 static bool g_wireframe = false;
 
 enum class Wireframe {solid, wireframe, both};
@@ -172,7 +173,9 @@ void drawTriangle(const TriangleBuffers triangle)
     scale += 0.01f;
     auto world = glm::rotate(glm::mat4(1.0f), scale, glm::vec3(g_xAxis, g_yAxis, g_zAxis));
 
-    glUniformMatrix4fv(g_world_uniform_loc, 1, GL_FALSE, glm::value_ptr(world));
+    // each program has its own location for "world"
+    const auto worldLoc = g_wireframe ? g_wireframe_world_uniform_loc : g_world_uniform_loc;
+    glUniformMatrix4fv(worldLoc, 1, GL_FALSE, glm::value_ptr(world));
 
     if (g_wireframe)
         glDrawElements(GL_LINE_STRIP, triangle.count, GL_UNSIGNED_INT, nullptr);
@@ -314,7 +317,7 @@ GLuint CreateTriangleGPUWireframeProgram()
         throw runtime_error{logMessage};
     }
 
-    g_world_uniform_loc = glGetUniformLocation(gpuProg, "world");
+    g_wireframe_world_uniform_loc = glGetUniformLocation(gpuProg, "world");
 
     if (glGetError() != GL_NO_ERROR)
         throw runtime_error{"Unable to get scale_uniform location"};
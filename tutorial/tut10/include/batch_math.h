@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <iosfwd>
+
+// Transform math over arrays, for the many objects of a frame. Every
+// function has an SSE4.1, AVX2 and AVX-512 kernel next to the glm one and
+// runs the best the CPU has, picked once at startup. The kernels do the
+// same float operations in the same order as glm's scalar operators, and
+// batch_math.cpp is built without FMA contraction, so every kernel gives
+// the bits glm gives; see RunMathBenchmark.
+enum class MathKernel {glm, sse41, avx2, avx512};
+
+std::ostream& operator << (std::ostream& out, MathKernel kernel);
+
+bool SupportsMathKernel(MathKernel kernel);
+
+// what the functions below run, the best supported kernel until set;
+// setting an unsupported one throws
+MathKernel CurrentMathKernel();
+void SetMathKernel(MathKernel kernel);
+
+// out[i] = a * b[i], like viewProjection * world for every object
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, size_t count);
+
+// out[i] = a[i] * b[i], like parent * local down a hierarchy
+void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count);
+
+// out[i] = a[i] * b[i] for affine transforms stored without their constant
+// last row, bit for bit glm::mat4x3(glm::mat4(a[i]) * glm::mat4(b[i]))
+void MultiplyAffine(const glm::mat4x3* a, const glm::mat4x3* b, glm::mat4x3* out, size_t count);
+
+// out[i] = glm::vec3(m * glm::vec4(points[i], 1.0f)), w is dropped
+void TransformPoints(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, size_t count);
+
+// out may be one of the inputs in all of them
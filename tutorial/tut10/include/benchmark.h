@@ -0,0 +1,137 @@
+#pragma once
+
+#include "gl_state.h"
+#include "stopwatch.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <map>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct Window;
+class Camera;
+
+struct Percentiles {
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+// nearest-rank percentiles, an empty sample set gives all zeros
+Percentiles ComputePercentiles(std::vector<double> samples);
+
+std::ostream& operator << (std::ostream& out, const Percentiles& p);
+
+struct BenchmarkReport {
+    std::string backend;
+    std::string renderer;
+    int warmup;
+    int frames;
+    float timestep;
+    std::vector<double> cpuMs;
+    std::vector<double> swapMs;
+    std::vector<double> gpuMs;
+    std::map<std::string, std::vector<double>> gpuPassMs;
+    size_t gpuStalls;
+    GLStateStats glState;
+};
+
+void WriteBenchmarkJson(std::ostream& out, const BenchmarkReport& report);
+
+// prints to stdout when path is empty
+void WriteBenchmarkOutput(const std::string& path, const std::string& json);
+
+struct BenchmarkSettings {
+    int warmup;
+    int frames;
+    size_t count;
+    std::string output;
+};
+
+struct FrameTimings {
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    GLStateStats glState;
+};
+
+std::ostream& operator << (std::ostream& out, const FrameTimings& timings);
+
+// draws warmup + frames frames with draw(frame) between clear and swap and
+// times the measured ones on the CPU (submission) and on the GPU, GL state
+// calls are counted over the measured frames only
+FrameTimings MeasureFrames(Window& window, const BenchmarkSettings& settings,
+                           const std::function<void(int)>& draw);
+
+// the mesh benchmarks draw their mesh this many times a frame, in two rows
+// of four spinning with the frame, so vertex work dominates
+const int meshBenchmarkDraws = 8;
+
+glm::mat4 MeshBenchmarkTransform(int draw, int frame);
+
+// N objects drawn one by one against a single instanced draw
+void RunInstancingBenchmark(Window& window, const Camera& camera,
+                            const BenchmarkSettings& settings);
+
+// the same sphere in the float layout against compressed ones: footprint,
+// round trip error and draw throughput; count sets the sphere vertex count
+void RunCompressionBenchmark(Window& window, const Camera& camera,
+                             const BenchmarkSettings& settings);
+
+// a sphere in shuffled triangle order against the same one after
+// OptimizeMesh: acmr/atvr and draw timings; count sets the vertex count
+void RunMeshOptimizerBenchmark(Window& window, const Camera& camera,
+                               const BenchmarkSettings& settings);
+
+// a field of spheres the camera flies through, all at full resolution
+// against levels picked by LodSelector: per frame triangle savings, level
+// switches and draw timings; count sets the sphere vertex count
+void RunLodBenchmark(Window& window, const Camera& camera, const BenchmarkSettings& settings);
+
+// a big sphere half off screen drawn whole against its meshlets culled on
+// the CPU and drawn with one glMultiDrawElements: culled fraction, draw
+// ranges, cull time and draw timings; count sets the sphere vertex count
+void RunMeshletBenchmark(Window& window, const Camera& camera, const BenchmarkSettings& settings);
+
+// the same sphere after OptimizeMesh drawn as a triangle list and as
+// strips joined with primitive restart: index counts and bytes, modelled
+// cache misses, which one ChoosePrimitives takes, and draw timings; count
+// sets the sphere vertex count
+void RunStripBenchmark(Window& window, const Camera& camera, const BenchmarkSettings& settings);
+
+// a Terrain over a generated 1024^2 heightmap seen from a camera circling
+// above it: per frame selection time, chunks, vertices and culled nodes
+// against the cap, and draw timings; count is unused
+void RunTerrainBenchmark(Window& window, const BenchmarkSettings& settings);
+
+// loading a mesh file through mmap against reading it into memory first and
+// against encoding the mesh on the spot; count sets the sphere vertex count
+void RunMeshFileBenchmark(const BenchmarkSettings& settings);
+
+// importing the same sphere from OBJ and from binary glTF on one thread
+// against all of them, MB/s and triangles/s; needs no window, count sets the
+// sphere vertex count
+void RunImportBenchmark(const BenchmarkSettings& settings);
+
+// the batch_math.h kernels against glm on count random matrices and points:
+// ns per item for every kernel the CPU runs, and whether each gives glm's
+// bits, throwing after the report when one doesn't; needs no window
+void RunMathBenchmark(const BenchmarkSettings& settings);
+
+// count random scale, worldPos and rotate chains through Pipeline against
+// the chained glm calls it replaced: ns per transform and mismatches,
+// throwing after the report when there are any; needs no window
+void RunPipelineBenchmark(const BenchmarkSettings& settings);
+
+// a TransformHierarchy of count nodes, three levels deep, with a growing
+// share of them moved every frame: update time and world matrices
+// recomputed against redoing all of them, checked against a full update;
+// needs no window
+void RunHierarchyBenchmark(const BenchmarkSettings& settings);
+
+// 10k, 100k and 1M random spheres and boxes around a camera culled by every
+// kernel frustum_cull.h has on one thread and by the best one on every
+// thread: ns per object and visible counts, checked against IntersectsSphere
+// and IntersectsBox; needs no window, count is unused
+void RunCullBenchmark(const BenchmarkSettings& settings);
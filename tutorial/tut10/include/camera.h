@@ -1,10 +1,19 @@
 #pragma once
 
-#include <glm/glm.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-
+#include <atomic>
+#include <cstdint>
+
+// A change only marks the matrices stale; the first read after it
+// recomputes view and viewProjection, and the inverses once one of them is
+// read, so a camera moved several times a frame does the math once. Every
+// change also takes a new revision, unique across all cameras, so a cache
+// keyed on it, a frustum or a uniform block, can tell when the camera it
+// was built from is still the same. Reads after a change write the cached
+// matrices, so a camera isn't safe to read from several threads until one
+// of them has read it.
 class Camera {
 public:
     Camera()
@@ -13,21 +22,27 @@ public:
         , m_up(0.0f, 1.0f, 0.0f)
         , m_projection{glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f)}
     {
+        changed();
     }
 
     Camera& ortho(float left, float right, float bottom, float up, float near, float far) noexcept
     {
         m_projection = glm::ortho(left, right, bottom, up, near, far);
+        changed();
+        return *this;
     }
 
     Camera& perspective(float fov, float ratio, float near, float far) noexcept
     {
         m_projection = glm::perspective(fov, ratio, near, far);
+        changed();
+        return *this;
     }
 
     Camera& position(const glm::vec3& newPos) noexcept
     {
         m_pos = newPos;
+        changed();
         return *this;
     }
 
@@ -35,6 +50,7 @@ public:
     {
         m_target = newTarget;
         glm::normalize(m_up);
+        changed();
         return *this;
     }
 
@@ -42,6 +58,7 @@ public:
     {
         m_up = newUp;
         glm::normalize(m_up);
+        changed();
         return *this;
     }
 
@@ -63,6 +80,7 @@ public:
     Camera& offsetPosition(const glm::vec3& offset) noexcept
     {
         m_pos += offset;
+        changed();
         return *this;
     }
 
@@ -70,6 +88,7 @@ public:
     {
         m_target += offset;
         glm::normalize(m_up);
+        changed();
         return *this;
     }
 
@@ -77,24 +96,92 @@ public:
     {
         m_up += offset;
         glm::normalize(m_up);
+        changed();
         return *this;
     }
 
     Camera& forward(float delta) noexcept
     {
         m_pos.z += delta;
+        changed();
         return *this;
     }
 
     Camera& lateral(float delta) noexcept
     {
         m_pos += glm::cross(m_up, m_target) * delta;
+        changed();
         return *this;
     }
 
-    operator glm::mat4 () const noexcept
+    const glm::mat4& view() const noexcept
+    {
+        return matrices().m_view;
+    }
+
+    const glm::mat4& projection() const noexcept
+    {
+        return m_projection;
+    }
+
+    const glm::mat4& viewProjection() const noexcept
+    {
+        return matrices().m_viewProjection;
+    }
+
+    const glm::mat4& inverseView() const noexcept
+    {
+        return inverses().m_inverseView;
+    }
+
+    const glm::mat4& inverseViewProjection() const noexcept
+    {
+        return inverses().m_inverseViewProjection;
+    }
+
+    uint64_t revision() const noexcept
     {
-        return m_projection * glm::lookAt(m_pos, m_pos + m_target, m_up);
+        return m_revision;
+    }
+
+    operator const glm::mat4& () const noexcept
+    {
+        return viewProjection();
+    }
+
+private:
+    void changed() noexcept
+    {
+        static std::atomic<uint64_t> revisions{0};
+
+        m_staleMatrices = true;
+        m_staleInverses = true;
+        m_revision = ++revisions;
+    }
+
+    const Camera& matrices() const noexcept
+    {
+        if (m_staleMatrices)
+        {
+            m_view = glm::lookAt(m_pos, m_pos + m_target, m_up);
+            m_viewProjection = m_projection * m_view;
+            m_staleMatrices = false;
+        }
+
+        return *this;
+    }
+
+    const Camera& inverses() const noexcept
+    {
+        if (m_staleInverses)
+        {
+            matrices();
+            m_inverseView = glm::inverse(m_view);
+            m_inverseViewProjection = glm::inverse(m_viewProjection);
+            m_staleInverses = false;
+        }
+
+        return *this;
     }
 
 private:
@@ -102,4 +189,11 @@ private:
     glm::vec3 m_target;
     glm::vec3 m_up;
     glm::mat4 m_projection;
+    mutable glm::mat4 m_view;
+    mutable glm::mat4 m_viewProjection;
+    mutable glm::mat4 m_inverseView;
+    mutable glm::mat4 m_inverseViewProjection;
+    mutable bool m_staleMatrices;
+    mutable bool m_staleInverses;
+    uint64_t m_revision;
 };
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+class Camera;
+
+// The six clip planes of a clip matrix (Gribb/Hartmann), normalized so the
+// signed distance to them is in the units of the space the matrix maps
+// from: viewProjection gives world space planes, viewProjection * world
+// object space ones. A point is inside when it is on the positive side of
+// all six.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+Frustum ExtractFrustum(const glm::mat4& clip);
+
+// world space planes of the camera's view-projection
+Frustum ExtractFrustum(const Camera& camera);
+
+// both conservative: a sphere or box that straddles two planes outside a
+// corner still counts as intersecting
+bool IntersectsSphere(const Frustum& frustum, const glm::vec3& center, float radius);
+bool IntersectsBox(const Frustum& frustum, const glm::vec3& low, const glm::vec3& high);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "frustum.h"
+#include <cstdint>
+#include <vector>
+
+// bounds as one array per coordinate, so the culler loads 4, 8 or 16 of
+// them into a register at once
+struct PackedSpheres {
+    std::vector<float> x, y, z, radius;
+
+    void add(const glm::vec3& center, float r);
+
+    size_t size() const noexcept
+    {
+        return x.size();
+    }
+};
+
+struct PackedBoxes {
+    std::vector<float> lowX, lowY, lowZ, highX, highY, highZ;
+
+    void add(const glm::vec3& low, const glm::vec3& high);
+
+    size_t size() const noexcept
+    {
+        return lowX.size();
+    }
+};
+
+// The indices of the bounds inside the frustum, in order, into visible,
+// which is resized to their count. Each takes the same decisions as
+// IntersectsSphere or IntersectsBox on every bound, testing 16 at a time
+// with AVX-512, 8 with AVX2 or 4 with SSE4.1, whichever CurrentMathKernel()
+// is. threads splits the bounds into ParallelFor ranges, 0 means every
+// hardware thread.
+size_t CullSpheres(const Frustum& frustum, const PackedSpheres& spheres,
+                   std::vector<uint32_t>& visible, unsigned threads = 1);
+size_t CullBoxes(const Frustum& frustum, const PackedBoxes& boxes,
+                 std::vector<uint32_t>& visible, unsigned threads = 1);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <iosfwd>
+#include <vector>
+
+struct GLStateStats {
+    size_t issued;
+    size_t skipped;
+};
+
+std::ostream& operator << (std::ostream& out, const GLStateStats& stats);
+
+// Shadow copy of the bindings and capabilities the renderer touches every
+// draw. A call that would set what is already set never reaches the driver
+// and is counted as skipped. Everything that binds programs, vertex arrays or
+// buffers must go through here, and tell it about deletions, or the shadow
+// goes stale; invalidate() forgets it all after foreign GL code ran.
+class GLState {
+public:
+    // tut10 renders from a single context
+    static GLState& current();
+
+    void useProgram(GLuint program);
+
+    // unbinding is deferred: nothing draws without enabling a program first,
+    // so the next useProgram usually finds nothing to do
+    void releaseProgram() noexcept;
+
+    void bindVertexArray(GLuint vao);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                         GLintptr offset, GLsizeiptr size);
+
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+
+    void forgetProgram(GLuint program);
+    void forgetVertexArray(GLuint vao);
+    void forgetBuffer(GLuint buffer);
+    void invalidate();
+
+    const GLStateStats& stats() const noexcept
+    {
+        return m_stats;
+    }
+
+    void resetStats() noexcept
+    {
+        m_stats = GLStateStats{0, 0};
+    }
+
+private:
+    GLState();
+
+    bool update(GLuint& cached, GLuint value);
+
+    struct BufferBinding {
+        GLenum target;
+        GLuint buffer;
+    };
+
+    struct IndexedBinding {
+        GLenum target;
+        GLuint index;
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    struct Capability {
+        GLenum capability;
+        bool enabled;
+    };
+
+    GLuint& cachedBuffer(GLenum target);
+    void setCapability(GLenum capability, bool enabled);
+
+private:
+    GLuint m_program;
+    GLuint m_vao;
+    std::vector<BufferBinding> m_buffers;
+    std::vector<IndexedBinding> m_indexed;
+    std::vector<Capability> m_capabilities;
+    GLStateStats m_stats;
+};
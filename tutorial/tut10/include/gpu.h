@@ -3,15 +3,66 @@
 #include <iosfwd>
 #include <string>
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <initializer_list>
 #include <vector>
 
 
 enum class ShaderType {vertex, fragment};
+
+// deferred leaves the compile status unchecked, asking for it is what makes
+// the driver finish the work on the calling thread
+enum class CompileMode {blocking, deferred};
+
+struct ShaderSource {
+    ShaderType type;
+    std::string source;
+};
+
+ShaderSource LoadShaderSource(ShaderType type, const std::string& path);
+
+class ProgramCache;
+
+// 32 bit FNV-1a of a uniform/block/attribute name. Being constexpr the hash
+// of a literal is computed by the compiler: "world"_id costs nothing at run
+// time, bind it to a constexpr variable to be sure.
+struct NameId {
+    uint32_t hash;
+};
+
+constexpr uint32_t HashName(const char* name, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ static_cast<unsigned char>(name[i])) * 16777619u;
+    return hash;
+}
+
+constexpr NameId operator "" _id(const char* name, size_t length)
+{
+    return NameId{HashName(name, length)};
+}
+
+enum class ResourceKind : uint8_t {uniform, block, attribute};
+
+// One active resource of a linked program: location for uniforms and
+// attributes, index for blocks. size is the array size, or the data size of
+// a block.
+struct ProgramResource {
+    ResourceKind kind;
+    uint32_t hash;
+    GLint location;
+    GLenum type;
+    GLint size;
+};
+
 class Shader {
 public:
 
     Shader(ShaderType type, std::ifstream&& file);
-    Shader(ShaderType type, const std::string& source);
+    Shader(ShaderType type, const std::string& source,
+           CompileMode mode = CompileMode::blocking);
     Shader(const Shader&) = delete;
     Shader(Shader&& rhs);
 
@@ -22,20 +73,40 @@ public:
 
 private:
     friend class Program;
+    friend class PendingProgram;
 
     operator GLuint() const noexcept
     {
         return m_shader;
     }
 
+    void check() const;
+
 private:
     ShaderType m_type;
     GLuint m_shader;
 };
 
+// A program object already linked by someone else, see PendingProgram.
+struct LinkedProgram {
+    GLuint program;
+    std::vector<Shader> shaders;
+};
+
+// A uniform block of the shaders and the binding point it reads from.
+struct UniformBlockBinding {
+    NameId name;
+    GLuint binding;
+};
+
 class Program {
 public:
     Program(std::vector<Shader>&& shaders);
+    Program(LinkedProgram&& linked);
+
+    // with a cache the program is restored from its stored binary when the
+    // driver accepts it, the sources are compiled only on a miss
+    Program(const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
     Program(const Program&) = delete;
     Program(Program&& rhs);
 
@@ -47,13 +118,85 @@ public:
     void enable();
     void disable();
 
+    // attaches the named block to a binding point, blocks the shaders don't
+    // use are ignored
+    void bindUniformBlock(const std::string& name, GLuint binding);
+    void bindUniformBlock(NameId name, GLuint binding);
+
+    // lookups in the table built at link time, -1 for inactive names just
+    // like glGetUniformLocation but without a string or a driver round-trip
+    GLint uniform(NameId name) const noexcept;
+    GLint attribute(NameId name) const noexcept;
+    GLint uniformBlock(NameId name) const noexcept;
+
+    const std::vector<ProgramResource>& resources() const noexcept
+    {
+        return m_resources;
+    }
+
+    // glProgramUniform*, the program doesn't need to be enabled
+    void setUniform(NameId name, GLint value);
+    void setUniform(NameId name, float value);
+    void setUniform(NameId name, const glm::vec4& value);
+    void setUniform(NameId name, const glm::mat4& value);
+
+protected:
+    // for the specific programs: like the constructors above, then binds the
+    // blocks their shaders declare, see bindUniformBlock
+    Program(LinkedProgram&& linked, std::initializer_list<UniformBlockBinding> blocks);
+    Program(const std::vector<ShaderSource>& sources, ProgramCache* cache,
+            std::initializer_list<UniformBlockBinding> blocks);
+
 private:
     void link();
     void validate();
+    void setup(std::initializer_list<UniformBlockBinding> blocks);
+    void reflect();
+    GLint find(ResourceKind kind, NameId name) const noexcept;
 
 protected:
     GLuint m_program;
 
 private:
     std::vector<Shader> m_shaders;
+    std::vector<ProgramResource> m_resources;
+};
+
+// Turns on GL_KHR_parallel_shader_compile (or the ARB flavour), returns
+// false when the driver doesn't have it and compiles stay synchronous.
+bool EnableParallelShaderCompile();
+
+// A program whose shaders were compiled and linked without asking for their
+// status. With parallel shader compile the driver builds it on its own
+// threads and ready() never blocks, so many programs can be in flight while
+// frames keep being rendered. get() checks the results, throwing the
+// compile/link log as the Program constructor would, and blocks only if the
+// program isn't ready yet.
+class PendingProgram {
+public:
+    PendingProgram(const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
+    PendingProgram(const PendingProgram&) = delete;
+    PendingProgram(PendingProgram&& rhs);
+
+    PendingProgram& operator = (const PendingProgram&) = delete;
+    PendingProgram& operator = (PendingProgram&& rhs);
+
+    ~PendingProgram();
+
+    bool ready() const;
+
+    template <typename P = Program>
+    P get()
+    {
+        return P{take()};
+    }
+
+private:
+    LinkedProgram take();
+
+private:
+    GLuint m_program;
+    std::vector<Shader> m_shaders;
+    ProgramCache* m_cache;
+    std::string m_key;
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Per-instance world matrices in their own buffer. The buffer is attached to
+// the mesh VAO on attributes 2-5 with a divisor of 1, so one
+// glDrawElementsInstanced draws every instance.
+class InstanceBuffer {
+public:
+    enum { firstAttribute = instanceLocation };
+
+    InstanceBuffer(const TriangleBuffers& mesh, size_t capacity);
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer(InstanceBuffer&& rhs);
+
+    InstanceBuffer& operator = (const InstanceBuffer&) = delete;
+    InstanceBuffer& operator = (InstanceBuffer&& rhs);
+
+    ~InstanceBuffer();
+
+    // the whole buffer is respecified every time, the driver doesn't have to
+    // wait for the draws still reading the previous transforms
+    void update(const std::vector<glm::mat4>& transforms);
+
+    size_t count() const noexcept
+    {
+        return m_count;
+    }
+
+private:
+    GLuint m_vbo;
+    size_t m_capacity;
+    size_t m_count;
+};
+
+void DrawInstanced(const TriangleBuffers& mesh, const InstanceBuffer& instances);
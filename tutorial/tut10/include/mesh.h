@@ -0,0 +1,92 @@
+#pragma once
+
+#include "vertex_format.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// mode is GL_TRIANGLES or GL_TRIANGLE_STRIP, indexType GL_UNSIGNED_SHORT or
+// GL_UNSIGNED_INT; see DrawMesh
+struct TriangleBuffers {
+    GLuint vao;
+    GLuint vbo;
+    GLuint ibo;
+    size_t count;
+    GLenum mode;
+    GLenum indexType;
+};
+
+// Ends a strip in an index list. Packed meshes are drawn with
+// GL_PRIMITIVE_RESTART_FIXED_INDEX, so this becomes the largest value of the
+// index type and many strips go in a single draw.
+const GLuint primitiveRestart = ~0u;
+
+// indices in the smallest type that addresses every vertex, the all ones
+// value of the type is left free for primitiveRestart
+struct IndexData {
+    GLenum type;
+    size_t count;
+    std::vector<unsigned char> bytes;
+};
+
+IndexData PackIndices(const std::vector<GLuint>& indices, size_t vertexCount);
+
+// strips joined with primitiveRestart, drawn as one GL_TRIANGLE_STRIP
+std::vector<GLuint> JoinStrips(const std::vector<std::vector<GLuint>>& strips);
+
+size_t IndexSize(GLenum type);
+
+// a mesh on the CPU before it is encoded into some VertexFormat, colors and
+// normals are optional (empty) or one per position
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec4> colors;
+    std::vector<glm::vec3> normals;
+    std::vector<GLuint> indices;
+};
+
+using CubeFormat = VertexFormat<Position3f, Color4u8n>;
+
+// uploads the vertices and indices into new buffers and records them in a new
+// vertex array, which is left bound together with the vertex buffer
+TriangleBuffers CreateMeshBuffers(const void* vertexes, size_t size,
+                                  const IndexData& indices, GLenum mode);
+
+// same from raw streams, both go to glBufferStorage as they are
+TriangleBuffers CreateMeshBuffers(const void* vertexes, size_t vertexBytes,
+                                  const void* indices, size_t indexCount,
+                                  GLenum indexType, GLenum mode);
+
+template<typename Format>
+TriangleBuffers CreateMesh(const std::vector<typename Format::Vertex>& vertexes,
+                           const std::vector<GLuint>& indices, GLenum mode = GL_TRIANGLES)
+{
+    auto mesh = CreateMeshBuffers(vertexes.data(), Format::stride * vertexes.size(),
+                                  PackIndices(indices, vertexes.size()), mode);
+    Format::setup();
+    return mesh;
+}
+
+// a range of the index buffer of a mesh, the indices are relative to
+// baseVertex
+struct Submesh {
+    std::uint32_t firstIndex;
+    std::uint32_t indexCount;
+    std::uint32_t baseVertex;
+};
+
+// binds the mesh and issues a single glDrawElements(Instanced) with its mode
+// and index type, primitive restart is enabled for strips
+void DrawMesh(const TriangleBuffers& mesh);
+void DrawMesh(const TriangleBuffers& mesh, GLsizei instances);
+void DrawSubmesh(const TriangleBuffers& mesh, const Submesh& submesh);
+
+// the colored cube of this tutorial, as strips or a list, see ChoosePrimitives
+TriangleBuffers CreateTriangleBuffer();
+
+// unit uv sphere of about `vertices` vertices, colored by its normals and
+// wound counter clockwise seen from outside like every other mesh
+MeshData SphereMeshData(size_t vertices);
+void DestroyTriangleBuffer(TriangleBuffers& buffers);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// Shared by the passes that walk a triangle list by its vertices: the mesh
+// optimizer, meshlets and strips.
+
+// vertex -> triangles using it, as offsets into one flat array: the
+// triangles around v are triangles[offsets[v]] to triangles[offsets[v + 1]]
+struct TriangleAdjacency {
+    std::vector<size_t> offsets;
+    std::vector<size_t> triangles;
+};
+
+// indices must pass CheckTriangleList
+TriangleAdjacency BuildTriangleAdjacency(const std::vector<GLuint>& indices, size_t vertexCount);
+
+// throws invalid_argument unless indices is a whole number of triangles and
+// out_of_range for an index past vertexCount
+void CheckTriangleList(const std::vector<GLuint>& indices, size_t vertexCount);
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "mesh.h"
+#include "vertex_compression.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Binary mesh container (.elm), native byte order:
+//
+//     MeshFileHeader
+//     MeshFileSubmesh[submeshCount]
+//     vertex stream, meshFileAlignment aligned, vertexCount * vertexStride bytes
+//     index stream, meshFileAlignment aligned, indexCount indices of indexType
+//
+// The streams are stored exactly as the GPU reads them, a mapped file goes
+// to glBufferStorage without being parsed or copied.
+
+const std::uint32_t meshFileMagic = 0x464d4c45; // "ELMF"
+const std::uint32_t meshFileVersion = 1;
+const std::uint64_t meshFileAlignment = 64;
+
+struct MeshFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t layout;          // VertexFormat::layout of the vertex stream
+    std::uint32_t vertexStride;
+    std::uint32_t vertexCount;
+    std::uint32_t indexType;
+    std::uint32_t indexCount;
+    std::uint32_t mode;
+    std::uint32_t submeshCount;
+    std::uint64_t vertexOffset;
+    std::uint64_t indexOffset;
+    float boundsCenter[3];         // the bounds boundsRelative positions use
+    float boundsExtent[3];
+};
+
+using MeshFileSubmesh = Submesh;
+
+// what converted assets are stored as, positions relative to the mesh bounds
+using AssetFormat = VertexFormat<Position3s16n, Color4u8n, Normal1010102>;
+
+// writes aside and renames, like ProgramCache::store
+void WriteMeshFile(const std::string& path, std::uint64_t layout, std::uint32_t stride,
+                   const void* vertexes, size_t vertexCount, const IndexData& indices,
+                   GLenum mode, const std::vector<Submesh>& submeshes, const MeshBounds& bounds);
+
+// encodes mesh into Format and writes it as a single submesh
+template<typename Format>
+void WriteMeshFile(const std::string& path, const MeshData& mesh, const MeshBounds& bounds,
+                   GLenum mode = GL_TRIANGLES)
+{
+    const auto vertexes = EncodeVertices<Format>(mesh, bounds);
+    const auto indices = PackIndices(mesh.indices, vertexes.size());
+
+    WriteMeshFile(path, Format::layout, Format::stride, vertexes.data(), vertexes.size(), indices,
+                  mode, {Submesh{0, static_cast<std::uint32_t>(indices.count), 0}}, bounds);
+}
+
+// checks a whole mesh file in memory: the header fields, and every offset and
+// submesh range against size; throws runtime_error naming path
+void ValidateMeshFile(const void* data, size_t size, const std::string& path);
+
+// A read only mapping of a mesh file. The header and every offset are checked
+// against the file size when it is opened, after that the streams are plain
+// pointers into the page cache.
+class MappedMeshFile {
+public:
+    explicit MappedMeshFile(const std::string& path);
+    MappedMeshFile(const MappedMeshFile&) = delete;
+    MappedMeshFile(MappedMeshFile&& rhs);
+
+    MappedMeshFile& operator = (const MappedMeshFile&) = delete;
+    MappedMeshFile& operator = (MappedMeshFile&& rhs);
+
+    ~MappedMeshFile();
+
+    const MeshFileHeader& header() const noexcept
+    {
+        return *reinterpret_cast<const MeshFileHeader*>(m_data);
+    }
+
+    const MeshFileSubmesh* submeshes() const noexcept
+    {
+        return reinterpret_cast<const MeshFileSubmesh*>(m_data + sizeof(MeshFileHeader));
+    }
+
+    const void* vertexes() const noexcept
+    {
+        return m_data + header().vertexOffset;
+    }
+
+    const void* indices() const noexcept
+    {
+        return m_data + header().indexOffset;
+    }
+
+    MeshBounds bounds() const noexcept;
+
+    size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+private:
+    void release() noexcept;
+    void validate(const std::string& path) const;
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+};
+
+// straight from the mapping into immutable buffers, throws when the file was
+// written with another vertex format
+template<typename Format>
+TriangleBuffers UploadMeshFile(const MappedMeshFile& file)
+{
+    const auto& header = file.header();
+    if (header.layout != Format::layout || header.vertexStride != Format::stride)
+        throw std::runtime_error{"Mesh file vertex layout does not match the format"};
+
+    auto mesh = CreateMeshBuffers(file.vertexes(), size_t(header.vertexCount) * header.vertexStride,
+                                  file.indices(), header.indexCount, header.indexType, header.mode);
+    Format::setup();
+    return mesh;
+}
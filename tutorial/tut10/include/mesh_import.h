@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh.h"
+#include <iosfwd>
+#include <string>
+
+struct ImportStats {
+    size_t bytes;
+    size_t vertices;
+    size_t triangles;
+    unsigned threads;
+    double ms;
+};
+
+// adds MB/s and triangles/s
+std::ostream& operator << (std::ostream& out, const ImportStats& stats);
+
+// Wavefront OBJ: v (with optional r g b), vn and f, polygons are fanned into
+// triangles, everything else is skipped. The file is split into chunks at
+// line boundaries that are parsed in parallel, the corners are then
+// deduplicated into vertices in parallel by hash partition.
+MeshData ImportObj(const std::string& path, unsigned threads = 0, ImportStats* stats = nullptr);
+
+// glTF 2.0, .gltf with data: uri or external buffers and binary .glb. Every
+// triangle primitive (list, strip or fan) reachable from the default scene is
+// flattened into one mesh with its node transforms applied; accessors are
+// decoded in parallel. Sparse accessors are not supported.
+MeshData ImportGltf(const std::string& path, unsigned threads = 0, ImportStats* stats = nullptr);
+
+// by extension: .obj, .gltf or .glb
+MeshData ImportMesh(const std::string& path, unsigned threads = 0, ImportStats* stats = nullptr);
+
+// area weighted smooth normals, for meshes that come without
+void ComputeNormals(MeshData& mesh);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "mesh.h"
+#include "vertex_compression.h"
+#include <iosfwd>
+#include <vector>
+
+class Camera;
+
+// Garland-Heckbert edge collapse on a triangle list: vertices collapse onto
+// a neighbour, so the result indexes the same vertex buffer and no attribute
+// is interpolated. Vertices on open borders and attribute seams stay put.
+// Stops at targetTriangles or when no collapse is left that doesn't flip a
+// triangle; error gets the largest area weighted RMS distance of a merged
+// vertex to the planes of the triangles it replaced, in mesh units.
+std::vector<GLuint> SimplifyMesh(const MeshData& mesh, const std::vector<GLuint>& indices,
+                                 size_t targetTriangles, float* error = nullptr);
+
+struct LodLevel {
+    Submesh submesh;
+    float error;      // summed RMS errors of the simplifications, in mesh units
+};
+
+// every level's indices one after the other in mesh.indices, level 0 is the
+// full mesh and each level has about reduction times the triangles of the
+// one before it
+struct LodChain {
+    MeshData mesh;
+    std::vector<LodLevel> levels;
+};
+
+// stops early when a level would go under minTriangles or barely shrinks;
+// the levels are cache optimized and share one fetch optimized vertex buffer
+LodChain GenerateLodChain(MeshData mesh, size_t maxLevels = 6, float reduction = 0.5f,
+                          size_t minTriangles = 32);
+
+struct LodFrameStats {
+    size_t objects;
+    size_t fullTriangles;   // what level 0 everywhere would have drawn
+    size_t drawnTriangles;
+    size_t switches;        // objects whose level changed this frame
+};
+
+// adds the fraction of triangles saved
+std::ostream& operator << (std::ostream& out, const LodFrameStats& stats);
+
+// Picks levels by projecting their error to pixels with the camera
+// projection, perspective or ortho, for a viewport viewportHeight pixels
+// high. An object moves to a coarser level only once its error is below
+// (1 - hysteresis) * threshold pixels but to a finer one as soon as the
+// current one is above threshold, so one hovering at a level boundary
+// doesn't pop back and forth every frame.
+class LodSelector {
+public:
+    LodSelector(float viewportHeight, float threshold = 1.0f, float hysteresis = 0.25f);
+
+    // call once per frame before select()
+    void beginFrame(const Camera& camera);
+
+    // bounds are the mesh bounds in object space, current the level drawn
+    // last frame for this object
+    size_t select(const LodChain& chain, const MeshBounds& bounds, const glm::mat4& world,
+                  size_t current);
+
+    // pixels an error of size error at distance from the camera covers
+    float projectedError(float error, float distance) const noexcept;
+
+    const LodFrameStats& stats() const noexcept
+    {
+        return m_stats;
+    }
+
+private:
+    float m_viewportHeight;
+    float m_threshold;
+    float m_hysteresis;
+    glm::vec3 m_eye;
+    float m_pixelsPerUnit;   // at distance 1, or anywhere for ortho
+    bool m_perspective;
+    LodFrameStats m_stats;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "mesh.h"
+#include <iosfwd>
+
+// Everything here works on triangle lists (no primitiveRestart) and models
+// the post transform cache as a FIFO of cacheSize vertices.
+
+// acmr: transformed vertices per triangle, 3 is the worst, a regular grid
+// tends to 0.5; atvr: transformed vertices per referenced vertex, 1 is ideal
+struct VertexCacheStats {
+    double acmr;
+    double atvr;
+};
+
+std::ostream& operator << (std::ostream& out, const VertexCacheStats& stats);
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount,
+                                     size_t cacheSize = 16);
+
+// Tipsify (Sander et al. 2007): fans around the last emitted vertices while
+// they are still in the cache. Returns the first triangle of every cluster,
+// where the fan had to jump somewhere else, starting with 0.
+std::vector<size_t> OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount,
+                                        size_t cacheSize = 16);
+
+// Splits the clusters further where that costs at most threshold times their
+// acmr, then draws the clusters facing away from the mesh center first:
+// from outside they are the likely occluders.
+void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<glm::vec3>& positions,
+                      const std::vector<size_t>& clusters, float threshold = 1.05f,
+                      size_t cacheSize = 16);
+
+// renumbers the vertices in the order the indices first use them, so fetch
+// walks the vertex buffer forward, and drops the ones never used
+void OptimizeVertexFetch(MeshData& mesh);
+
+struct MeshOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t verticesBefore;
+    size_t verticesAfter;
+    double ms;
+};
+
+std::ostream& operator << (std::ostream& out, const MeshOptimizationReport& report);
+
+// cache, overdraw and fetch in that order, run it on every mesh before upload
+MeshOptimizationReport OptimizeMesh(MeshData& mesh);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include <iosfwd>
+
+// Turns a triangle list into strips joined with primitiveRestart, for a
+// single GL_TRIANGLE_STRIP draw. A strip grows across the edge its last two
+// vertices share with an unused triangle of the same winding and restarts
+// when there is none. Seeds follow the input order, and with a window a
+// strip only takes triangles less than window triangles past the first
+// unused one, so a cache optimized order survives; 0 lets strips run free.
+std::vector<GLuint> Stripify(const std::vector<GLuint>& indices, size_t vertexCount,
+                             size_t window = 64);
+
+// the triangle list a strip stream draws, degenerate triangles dropped
+std::vector<GLuint> UnstripIndices(const std::vector<GLuint>& strips);
+
+// A mesh's indices as the list or as strips, whichever is cheaper. Strips
+// are taken when they need fewer index bytes and transform at most
+// tolerance more vertices than the list in the FIFO cache model of
+// mesh_optimizer.h, since vertex work usually dominates index fetch.
+struct PrimitiveChoice {
+    GLenum mode;
+    std::vector<GLuint> indices;
+    size_t listBytes;
+    size_t stripBytes;
+    VertexCacheStats list;
+    VertexCacheStats strip;
+};
+
+// everything but the indices
+std::ostream& operator << (std::ostream& out, const PrimitiveChoice& choice);
+
+PrimitiveChoice ChoosePrimitives(const std::vector<GLuint>& indices, size_t vertexCount,
+                                 float tolerance = 0.02f, size_t cacheSize = 16);
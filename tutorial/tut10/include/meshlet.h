@@ -0,0 +1,58 @@
+#pragma once
+
+#include "mesh.h"
+#include <iosfwd>
+#include <vector>
+
+// A run of triangles in the index buffer that is culled as a unit: a
+// bounding sphere for the frustum and a normal cone for back faces, both in
+// mesh units. Every triangle normal (counter clockwise front faces) is
+// within the cone around coneAxis; coneCutoff is the sine of its half angle,
+// 1 when the triangles face too many ways for the cone to ever cull.
+struct Meshlet {
+    std::uint32_t firstIndex;
+    std::uint32_t indexCount;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+const size_t meshletMaxTriangles = 124;
+const size_t meshletMaxVertices = 64;
+
+// Reorders the triangles of mesh.indices into meshlets of up to maxTriangles
+// triangles and maxVertices distinct vertices, each grown from a seed
+// through the triangles that add the fewest new vertices, ties broken by
+// the normal closest to the meshlet's. The vertices are untouched, so
+// OptimizeVertexFetch can run afterwards.
+std::vector<Meshlet> BuildMeshlets(MeshData& mesh, size_t maxTriangles = meshletMaxTriangles,
+                                   size_t maxVertices = meshletMaxVertices);
+
+// what survived culling, as arguments for glMultiDrawElements; meshlets
+// next to each other in the index buffer are merged into one range
+struct MeshletDrawList {
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+};
+
+struct MeshletCullStats {
+    size_t meshlets;
+    size_t frustumCulled;
+    size_t backfaceCulled;
+    size_t draws;
+    size_t triangles;
+};
+
+// adds the fraction of meshlets culled
+std::ostream& operator << (std::ostream& out, const MeshletCullStats& stats);
+
+// Culls meshlets of a mesh drawn with world against the frustum of
+// viewProjection and the back faces seen from eye (world space), then fills
+// list. The tests run in object space and are conservative.
+MeshletCullStats CullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& world,
+                              const glm::mat4& viewProjection, const glm::vec3& eye,
+                              GLenum indexType, MeshletDrawList& list);
+
+// a single glMultiDrawElements over the surviving ranges
+void DrawMeshlets(const TriangleBuffers& mesh, const MeshletDrawList& list);
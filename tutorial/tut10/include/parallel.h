@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// hardware threads, at least 1
+unsigned HardwareThreads();
+
+// Splits [0, count) into one contiguous range per worker and runs
+// work(begin, end, worker) on each, the calling thread takes the first range.
+// Returns once every range is done; an exception thrown by any of them is
+// rethrown here. threads == 0 means HardwareThreads().
+void ParallelFor(size_t count, unsigned threads,
+                 const std::function<void(size_t begin, size_t end, unsigned worker)>& work);
+
+// the number of ranges ParallelFor will use for count items
+unsigned ParallelWorkers(size_t count, unsigned threads);
@@ -1,33 +1,168 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 
-class Pipeline {
+// a step whose chain is thrown away does nothing, so `p.scale(s);` warns
+#if __cplusplus >= 201703L
+#define PIPELINE_NODISCARD [[nodiscard]]
+#elif defined(__GNUC__)
+#define PIPELINE_NODISCARD __attribute__((warn_unused_result))
+#else
+#define PIPELINE_NODISCARD
+#endif
+
+namespace detail {
+
+// the steps of a Pipeline: apply multiplies an affine matrix by the step
+// from the right with the float operations glm::scale, glm::translate and
+// glm::rotate use on the columns they change, matrix is the step on its own
+
+struct PipelineScale {
+    glm::vec3 factors;
+
+    void apply(glm::mat4& m) const noexcept
+    {
+        m[0] = m[0] * factors[0];
+        m[1] = m[1] * factors[1];
+        m[2] = m[2] * factors[2];
+    }
+
+    glm::mat4 matrix() const noexcept
+    {
+        return glm::mat4{glm::vec4{factors[0], 0.0f, 0.0f, 0.0f}, glm::vec4{0.0f, factors[1], 0.0f, 0.0f},
+                         glm::vec4{0.0f, 0.0f, factors[2], 0.0f}, glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+    }
+};
+
+struct PipelineTranslate {
+    glm::vec3 offset;
+
+    void apply(glm::mat4& m) const noexcept
+    {
+        m[3] = m[0] * offset[0] + m[1] * offset[1] + m[2] * offset[2] + m[3];
+    }
+
+    glm::mat4 matrix() const noexcept
+    {
+        return glm::mat4{glm::vec4{1.0f, 0.0f, 0.0f, 0.0f}, glm::vec4{0.0f, 1.0f, 0.0f, 0.0f},
+                         glm::vec4{0.0f, 0.0f, 1.0f, 0.0f}, glm::vec4{offset, 1.0f}};
+    }
+};
+
+struct PipelineRotate {
+    float angle;
+    glm::vec3 axis;
+
+    void apply(glm::mat4& m) const noexcept
+    {
+        const auto r = matrix();
+        const auto c0 = m[0] * r[0][0] + m[1] * r[0][1] + m[2] * r[0][2];
+        const auto c1 = m[0] * r[1][0] + m[1] * r[1][1] + m[2] * r[1][2];
+        const auto c2 = m[0] * r[2][0] + m[1] * r[2][1] + m[2] * r[2][2];
+
+        m[0] = c0;
+        m[1] = c1;
+        m[2] = c2;
+    }
+
+    glm::mat4 matrix() const noexcept
+    {
+        const auto c = std::cos(angle);
+        const auto s = std::sin(angle);
+        const auto u = glm::normalize(axis);
+        const auto t = (1.0f - c) * u;
+
+        return glm::mat4{glm::vec4{c + t[0] * u[0], t[0] * u[1] + s * u[2], t[0] * u[2] - s * u[1], 0.0f},
+                         glm::vec4{t[1] * u[0] - s * u[2], c + t[1] * u[1], t[1] * u[2] + s * u[0], 0.0f},
+                         glm::vec4{t[2] * u[0] + s * u[1], t[2] * u[1] - s * u[0], c + t[2] * u[2], 0.0f},
+                         glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+    }
+};
+
+} // detail
+
+template<typename Previous, typename Step>
+class PipelineChain;
+
+// The world transform as a chain of steps applied in call order, like
+// glm::scale, glm::translate and glm::rotate on a matrix. Every call returns
+// a new chain holding the steps by value, and nothing is computed until it
+// converts to a matrix. Then it is one pass that starts from the first
+// step's own matrix instead of multiplying the identity, and touches only
+// the columns each step changes, the last row staying 0, 0, 0, 1. The
+// result equals the chained glm calls value for value; only the sign of a
+// zero can differ.
+//
+//     const auto world = Pipeline{}.scale(s).worldPos(p).rotate(angle, axis);
+template<typename Chain>
+class PipelineSteps {
 public:
-    Pipeline& scale(const glm::vec3& scale) noexcept
+    PIPELINE_NODISCARD PipelineChain<Chain, detail::PipelineScale> scale(const glm::vec3& scale) const noexcept
+    {
+        return {self(), detail::PipelineScale{scale}};
+    }
+
+    PIPELINE_NODISCARD PipelineChain<Chain, detail::PipelineTranslate> worldPos(const glm::vec3& pos) const noexcept
+    {
+        return {self(), detail::PipelineTranslate{pos}};
+    }
+
+    PIPELINE_NODISCARD PipelineChain<Chain, detail::PipelineRotate> rotate(float angle, const glm::vec3& axies) const noexcept
     {
-        m_transformation = glm::scale(m_transformation, scale);
-        return *this;
+        return {self(), detail::PipelineRotate{angle, axies}};
     }
 
-    Pipeline& worldPos(const glm::vec3& pos) noexcept
+    operator glm::mat4 () const noexcept
     {
-        m_transformation = glm::translate(m_transformation, pos);
-        return *this;
+        return self().evaluate();
     }
 
-    Pipeline& rotate(float angle, const glm::vec3& axies) noexcept
+private:
+    const Chain& self() const noexcept
+    {
+        return static_cast<const Chain&>(*this);
+    }
+};
+
+// the empty chain, the identity
+class Pipeline : public PipelineSteps<Pipeline> {
+public:
+    PIPELINE_NODISCARD glm::mat4 evaluate() const noexcept
+    {
+        return glm::mat4{1.0f};
+    }
+};
+
+template<typename Previous, typename Step>
+class PipelineChain : public PipelineSteps<PipelineChain<Previous, Step>> {
+public:
+    PipelineChain(const Previous& previous, const Step& step) noexcept
+        : m_previous(previous)
+        , m_step(step)
+    {
+    }
+
+    PIPELINE_NODISCARD glm::mat4 evaluate() const noexcept
+    {
+        return compose(m_previous, m_step);
+    }
+
+private:
+    template<typename Chain>
+    static glm::mat4 compose(const Chain& previous, const Step& step) noexcept
     {
-        m_transformation = glm::rotate(m_transformation, angle, axies);
-        return *this;
+        auto m = previous.evaluate();
+        step.apply(m);
+        return m;
     }
 
-    operator const glm::mat4& () const noexcept
+    static glm::mat4 compose(const Pipeline&, const Step& step) noexcept
     {
-        return m_transformation;
+        return step.matrix();
     }
 
 private:
-    glm::mat4 m_transformation;
+    Previous m_previous;
+    Step m_step;
 };
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct GpuScopeResult {
+    const char* name;
+    int parent;
+    int depth;
+    double startMs;
+    double durationMs;
+};
+
+// Scopes are stored depth first, scopes[0] is the whole frame.
+struct GpuFrameProfile {
+    size_t frame;
+    std::vector<GpuScopeResult> scopes;
+
+    double totalMs() const noexcept
+    {
+        return scopes.empty() ? 0.0 : scopes[0].durationMs;
+    }
+
+    // "frame/parent/name"
+    std::string path(size_t scope) const;
+};
+
+std::ostream& operator << (std::ostream& out, const GpuFrameProfile& profile);
+
+// Hierarchical GPU profiler built on GL_TIMESTAMP queries. Every frame owns a
+// slot in a ring `latency` frames deep, a slot is read back only once the GPU
+// is done with it, so timing never waits on the pipeline unless the ring is
+// full (counted by stalls()). Scope names must outlive the profiler.
+class GpuProfiler {
+public:
+    explicit GpuProfiler(size_t latency = 4);
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator = (const GpuProfiler&) = delete;
+    ~GpuProfiler();
+
+    void beginFrame();
+    void endFrame();
+
+    void pushScope(const char* name);
+    void popScope();
+
+    // moves the oldest finished frame into profile
+    bool nextResult(GpuFrameProfile& profile);
+
+    // waits for every frame still in flight
+    void flush();
+
+    size_t stalls() const noexcept
+    {
+        return m_stalls;
+    }
+
+private:
+    struct Scope {
+        const char* name;
+        int parent;
+        int depth;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Frame {
+        size_t index;
+        bool pending;
+        size_t used;
+        std::vector<Scope> scopes;
+        std::vector<GLuint> queries;
+    };
+
+    Frame& current();
+    size_t issueTimestamp(Frame& frame);
+    bool readBack(Frame& frame, bool wait);
+    void collect(bool wait);
+
+private:
+    std::vector<Frame> m_frames;
+    std::vector<int> m_stack;
+    std::deque<GpuFrameProfile> m_results;
+    size_t m_frameIndex;
+    size_t m_collected;
+    size_t m_stalls;
+    bool m_inFrame;
+};
+
+class GpuScope {
+public:
+    GpuScope(GpuProfiler& profiler, const char* name)
+        : m_profiler(profiler)
+    {
+        m_profiler.pushScope(name);
+    }
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator = (const GpuScope&) = delete;
+
+    ~GpuScope()
+    {
+        m_profiler.popScope();
+    }
+
+private:
+    GpuProfiler& m_profiler;
+};
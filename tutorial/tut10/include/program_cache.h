@@ -0,0 +1,43 @@
+#pragma once
+
+#include "gpu.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ProgramCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t rejected;
+    size_t stored;
+};
+
+// On-disk cache of glGetProgramBinary blobs. Entries are keyed by a hash of
+// the shader sources together with the GL vendor, renderer and version, so a
+// driver update never even sees binaries of another build. A binary the
+// driver still refuses is counted as rejected and the program is compiled
+// from source as on a miss.
+class ProgramCache {
+public:
+    // the directory is created when missing, needs a current GL context
+    explicit ProgramCache(const std::string& directory);
+
+    std::string key(const std::vector<ShaderSource>& sources) const;
+
+    bool load(GLuint program, const std::string& key);
+    void store(GLuint program, const std::string& key);
+
+    const ProgramCacheStats& stats() const noexcept
+    {
+        return m_stats;
+    }
+
+private:
+    std::string path(const std::string& key) const;
+
+private:
+    std::string m_directory;
+    std::string m_driver;
+    bool m_supported;
+    ProgramCacheStats m_stats;
+};
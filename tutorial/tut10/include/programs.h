@@ -0,0 +1,54 @@
+#pragma once
+
+#include "gpu.h"
+
+struct MeshBounds;
+
+// The programs bind the uniform blocks their shaders declare to the binding
+// points of uniforms.h when they are created: every one reads the camera from
+// the Frame block, TriangleProgram and LitProgram the world matrix from the
+// Object block.
+class TriangleProgram : public Program {
+public:
+    TriangleProgram(const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
+    TriangleProgram(LinkedProgram&& linked);
+};
+
+// Draws a mesh once per instance, the world matrix of every instance comes
+// from the InstanceBuffer attached to the mesh VAO.
+class InstancedProgram : public Program {
+public:
+    InstancedProgram(const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
+    InstancedProgram(LinkedProgram&& linked);
+};
+
+// Shaded by a fixed directional light. Reads the normal from normalLocation,
+// either as a vector (lit.vs) or octahedral encoded (lit_oct.vs), and maps the
+// position back from the mesh bounds given to setBounds.
+class LitProgram : public Program {
+public:
+    LitProgram(const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
+    LitProgram(LinkedProgram&& linked);
+
+    void setBounds(const MeshBounds& bounds);
+};
+
+// Draws Terrain chunks: the node being drawn comes from the Chunk block, bound
+// to objectBinding per draw, and the heights from the texture on unit 0.
+class TerrainProgram : public Program {
+public:
+    TerrainProgram(const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
+    TerrainProgram(LinkedProgram&& linked);
+};
+
+enum class NormalEncoding {vector, octahedral};
+
+std::vector<ShaderSource> TriangleGPUProgramSources();
+std::vector<ShaderSource> InstancedGPUProgramSources();
+std::vector<ShaderSource> LitGPUProgramSources(NormalEncoding normals);
+std::vector<ShaderSource> TerrainGPUProgramSources();
+
+TriangleProgram CreateTriangleGPUProgram(ProgramCache* cache = nullptr);
+InstancedProgram CreateInstancedGPUProgram(ProgramCache* cache = nullptr);
+LitProgram CreateLitGPUProgram(NormalEncoding normals, ProgramCache* cache = nullptr);
+TerrainProgram CreateTerrainGPUProgram(ProgramCache* cache = nullptr);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+
+// wall clock time since construction or the last restart
+class Stopwatch {
+public:
+    Stopwatch()
+        : m_start{clock::now()}
+    {
+    }
+
+    void restart() noexcept
+    {
+        m_start = clock::now();
+    }
+
+    double elapsedMs() const noexcept
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - m_start).count();
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    clock::time_point m_start;
+};
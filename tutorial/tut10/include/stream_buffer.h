@@ -0,0 +1,79 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstring>
+#include <iosfwd>
+#include <vector>
+
+struct StreamAllocation {
+    void* data;
+    GLintptr offset;
+    size_t size;
+};
+
+struct StreamStats {
+    size_t frames;
+    size_t waits;
+    double waitMs;
+    size_t peakBytes;
+};
+
+std::ostream& operator << (std::ostream& out, const StreamStats& stats);
+
+// Ring of `regions` frame regions in one buffer created with glBufferStorage
+// and mapped once, persistent and coherent. A frame writes straight into its
+// region, the region is fenced when the next frame starts and reused only
+// once the GPU signalled that fence. Any time the CPU had to block on a fence
+// is counted in stats().
+//
+// The buffer can be bound to any target: vertices, indices and uniform
+// blocks can share it as long as each allocation honours its own alignment.
+class StreamBuffer {
+public:
+    StreamBuffer(size_t regionSize, size_t regions = 3);
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer(StreamBuffer&& rhs);
+
+    StreamBuffer& operator = (const StreamBuffer&) = delete;
+    StreamBuffer& operator = (StreamBuffer&& rhs);
+
+    ~StreamBuffer();
+
+    // fences every command issued so far against the current region, then
+    // moves to the next one
+    void nextFrame();
+
+    // alignment is in bytes and can't be zero
+    StreamAllocation allocate(size_t size, size_t alignment);
+
+    template <typename T>
+    StreamAllocation push(const T* data, size_t count, size_t alignment = alignof(T))
+    {
+        auto allocation = allocate(sizeof(T) * count, alignment);
+        std::memcpy(allocation.data, data, allocation.size);
+        return allocation;
+    }
+
+    GLuint buffer() const noexcept
+    {
+        return m_buffer;
+    }
+
+    const StreamStats& stats() const noexcept
+    {
+        return m_stats;
+    }
+
+private:
+    void waitRegion(size_t region);
+    void release();
+
+private:
+    GLuint m_buffer;
+    unsigned char* m_mapping;
+    size_t m_regionSize;
+    size_t m_region;
+    size_t m_used;
+    std::vector<GLsync> m_fences;
+    StreamStats m_stats;
+};
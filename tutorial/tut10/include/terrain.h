@@ -0,0 +1,144 @@
+#pragma once
+
+#include "frustum.h"
+#include "mesh.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+class Camera;
+class TerrainProgram;
+class UniformArena;
+
+// size x size heights in [0, 1], row major with x along a row
+class Heightmap {
+public:
+    Heightmap(size_t size, std::vector<float> heights);
+
+    size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    float at(size_t x, size_t z) const noexcept
+    {
+        return m_heights[z * m_size + x];
+    }
+
+    const std::vector<float>& heights() const noexcept
+    {
+        return m_heights;
+    }
+
+private:
+    size_t m_size;
+    std::vector<float> m_heights;
+};
+
+// fractal value noise, the same seed always gives the same ground
+Heightmap GenerateHeightmap(size_t size, unsigned seed = 1);
+
+struct TerrainSettings {
+    float worldSize = 4096.0f;     // the heightmap covers worldSize^2 centered on the origin
+    float heightScale = 400.0f;    // height of a 1 in the heightmap
+    int gridSize = 32;             // quads along a side of the shared grid, even
+    int lodLevels = 8;             // the root node is drawn at level lodLevels - 1
+    float lodDistance = 96.0f;     // range of level 0, every next level doubles it
+    float morphRatio = 0.3f;       // part of a range over which a level morphs into the next
+    size_t maxChunks = 400;        // hard cap on the selection, see Terrain::select
+};
+
+// std140 mirror of the Chunk block: the corner and size of the node, its
+// level, and the camera distances over which it morphs into the next level
+struct TerrainChunk {
+    glm::vec4 node;    // x, z, size, level
+    glm::vec4 morph;   // start, end
+};
+
+struct TerrainStats {
+    size_t nodes;       // visited
+    size_t culled;      // outside the frustum
+    size_t chunks;      // selected
+    size_t vertices;    // drawn, at most maxChunks grids
+    size_t triangles;
+};
+
+std::ostream& operator << (std::ostream& out, const TerrainStats& stats);
+
+// CDLOD (Strugar 2010): a quadtree over the heightmap whose every node is
+// drawn with the same grid mesh, displaced in the vertex shader. A node is
+// drawn at its level when the camera is within its range and refined into
+// its children when within the range of the next finer level; the children
+// out of that range are drawn by their parent as quarters of the grid.
+// Toward the end of its range a vertex morphs onto the grid of the next
+// coarser level, so levels meet without cracks or popping. Nodes outside the
+// camera frustum are skipped by their min/max height box.
+class Terrain {
+public:
+    Terrain(const Heightmap& heightmap, const TerrainSettings& settings = TerrainSettings{});
+    Terrain(const Terrain&) = delete;
+    Terrain(Terrain&& rhs);
+
+    Terrain& operator = (const Terrain&) = delete;
+    Terrain& operator = (Terrain&& rhs);
+
+    ~Terrain();
+
+    // picks the chunks for this camera. At most maxChunks are selected,
+    // each at most one grid of (gridSize + 1)^2 vertices, so the cost of a
+    // frame is bounded whatever the view. The quadtree is walked breadth
+    // first, so past the cap the finest level is left out evenly rather
+    // than in one corner of the view. A camera of the same revision as the
+    // last one keeps the last selection.
+    const TerrainStats& select(const Camera& camera);
+
+    // draws the last selection, the chunks are pushed to chunks
+    void draw(TerrainProgram& program, UniformArena& chunks);
+
+    const TerrainSettings& settings() const noexcept
+    {
+        return m_settings;
+    }
+
+private:
+    // a node, or the quarters of it set in quadrants (bit x + 2 z)
+    struct Selected {
+        TerrainChunk chunk;
+        std::uint32_t quadrants;
+    };
+
+    // min and max height of every node, finest level first
+    struct Level {
+        size_t nodes;                      // per side
+        std::vector<glm::vec2> heights;
+    };
+
+    // a node waiting in the breadth first walk of select
+    struct Pending {
+        int level;
+        size_t x;
+        size_t z;
+    };
+
+    void addChunk(int level, size_t x, size_t z, std::uint32_t quadrants);
+    void nodeBox(int level, size_t x, size_t z, glm::vec3& low, glm::vec3& high) const noexcept;
+    float nodeSize(int level) const noexcept;
+    void release() noexcept;
+
+private:
+    TerrainSettings m_settings;
+    std::vector<Level> m_levels;
+    std::vector<float> m_ranges;
+    std::vector<Selected> m_selection;
+    std::vector<Pending> m_pending;
+    TerrainStats m_stats;
+    glm::vec3 m_eye;
+    Frustum m_frustum;
+    std::uint64_t m_cameraRevision;
+    size_t m_heightmapSize;
+    GLuint m_texture;
+    TriangleBuffers m_grid;
+    std::vector<Submesh> m_quadrants;
+};
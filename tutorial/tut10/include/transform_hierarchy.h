@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// a node's transform relative to its parent: scaled, then rotated by angle
+// around axis, then moved to position, like
+// Pipeline{}.worldPos(position).rotate(angle, axis).scale(scale)
+struct LocalTransform {
+    glm::vec3 position{0.0f};
+    float angle = 0.0f;
+    glm::vec3 axis{0.0f, 1.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+// Scene transforms as a tree, kept as arrays of each field in depth-first
+// order, so a node's subtree is the run of slots right after it and a
+// parent always comes before its children. Changing a local transform only
+// marks the node; update() then recomputes the world matrices of the marked
+// subtrees in one forward pass and leaves every other node alone, so a
+// frame costs what changed rather than the whole scene. Runs of leaf
+// siblings share their parent's matrix and go through MultiplyMatrices in
+// one call.
+//
+// Nodes are handles that stay valid as the tree grows. Adding a node to the
+// last subtree appends it; adding one anywhere else shifts every slot after
+// its place, so scenes are best built parent first, a subtree at a time.
+class TransformHierarchy {
+public:
+    using Node = uint32_t;
+    static const Node noParent = ~Node{0};
+
+    Node add(const LocalTransform& local, Node parent = noParent);
+
+    LocalTransform local(Node node) const;
+    void setLocal(Node node, const LocalTransform& local);
+
+    // recomputes what changed since the last update, returns how many world
+    // matrices that was
+    size_t update();
+
+    // as of the last update
+    const glm::mat4& world(Node node) const;
+
+    // every world matrix in depth-first order, for uploading them in one go
+    const std::vector<glm::mat4>& worlds() const noexcept
+    {
+        return m_world;
+    }
+
+    size_t size() const noexcept
+    {
+        return m_node.size();
+    }
+
+private:
+    uint32_t slot(Node node) const;
+    void insertSlot(uint32_t at, Node node, uint32_t parent, const LocalTransform& local);
+    void updateRange(uint32_t first, uint32_t end);
+
+private:
+    // per node handle
+    std::vector<uint32_t> m_slot;
+
+    // per slot
+    std::vector<Node> m_node;
+    std::vector<uint32_t> m_parent;
+    std::vector<uint32_t> m_end;         // one past the last slot of the subtree
+    std::vector<glm::vec3> m_position;
+    std::vector<float> m_angle;
+    std::vector<glm::vec3> m_axis;
+    std::vector<glm::vec3> m_scale;
+    std::vector<glm::mat4> m_local;
+    std::vector<glm::mat4> m_world;
+    std::vector<uint8_t> m_dirty;
+
+    std::vector<Node> m_dirtyNodes;
+};
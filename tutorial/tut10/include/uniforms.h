@@ -0,0 +1,100 @@
+#pragma once
+
+#include "camera.h"
+#include "stream_buffer.h"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Binding points shared by every program, see Program::bindUniformBlock.
+enum UniformBinding : GLuint {
+    frameBinding = 0,
+    objectBinding = 1
+};
+
+// std140 mirror of the Frame block: only mat4/vec4 members, so the C++
+// layout matches without any padding
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 time;
+};
+
+// std140 mirror of the Object block
+struct ObjectUniforms {
+    glm::mat4 world;
+};
+
+// A uniform buffer updated once per frame and bound to a fixed binding point.
+class UniformBuffer {
+public:
+    UniformBuffer(GLuint binding, size_t size);
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer(UniformBuffer&& rhs);
+
+    UniformBuffer& operator = (const UniformBuffer&) = delete;
+    UniformBuffer& operator = (UniformBuffer&& rhs);
+
+    ~UniformBuffer();
+
+    template <typename T>
+    void update(const T& data)
+    {
+        update(&data, sizeof(T));
+    }
+
+    void update(const void* data, size_t size);
+    void bind() const;
+
+private:
+    GLuint m_ubo;
+    GLuint m_binding;
+    size_t m_size;
+};
+
+// The per-object blocks of a frame, sub-allocated from a StreamBuffer: each
+// block is written straight into persistently mapped memory and selected per
+// draw with glBindBufferRange.
+class UniformArena {
+public:
+    UniformArena(GLuint binding, size_t capacity);
+
+    // call once per frame, before the first push
+    void nextFrame()
+    {
+        m_stream.nextFrame();
+    }
+
+    // returns the offset to bind() the block at
+    template <typename T>
+    GLintptr push(const T& data)
+    {
+        return push(&data, sizeof(T));
+    }
+
+    GLintptr push(const void* data, size_t size);
+
+    template <typename T>
+    void bind(GLintptr offset) const
+    {
+        bind(offset, sizeof(T));
+    }
+
+    void bind(GLintptr offset, size_t size) const;
+
+    const StreamStats& stats() const noexcept
+    {
+        return m_stream.stats();
+    }
+
+    // bytes one block of the given size takes in the arena
+    static size_t stride(size_t size);
+
+private:
+    StreamBuffer m_stream;
+    GLuint m_binding;
+    size_t m_alignment;
+};
+
+// fills the Frame block from the camera and binds it for the whole frame
+void UpdateFrameUniforms(UniformBuffer& frameUniforms, const Camera& camera, float time);
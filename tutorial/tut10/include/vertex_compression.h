@@ -0,0 +1,129 @@
+#pragma once
+
+#include "mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <iosfwd>
+#include <type_traits>
+
+// Axis aligned box of a mesh as center and half size. Positions encoded
+// relative to it use the full range of a 16 bit format whatever the scale of
+// the mesh; the vertex shader gets both as uniforms (boundsCenter and
+// boundsExtent) to map them back.
+struct MeshBounds {
+    glm::vec3 center;
+    glm::vec3 extent;
+
+    glm::vec3 encode(const glm::vec3& position) const noexcept
+    {
+        return (position - center) / extent;
+    }
+
+    glm::vec3 decode(const glm::vec3& encoded) const noexcept
+    {
+        return center + encoded * extent;
+    }
+};
+
+// a flat axis gets a tiny extent instead of zero so encode() stays finite
+MeshBounds ComputeBounds(const std::vector<glm::vec3>& positions);
+
+// identity bounds for formats that store absolute positions
+MeshBounds IdentityBounds();
+
+struct EncodingError {
+    float position;
+    float normalDegrees;
+    float color;
+};
+
+std::ostream& operator << (std::ostream& out, const EncodingError& error);
+
+namespace detail {
+
+template<typename Attribute>
+typename Attribute::value_type AttributeValue(const MeshData& mesh, const MeshBounds& bounds,
+                                              size_t vertex, std::integral_constant<GLuint, positionLocation>)
+{
+    return Attribute::boundsRelative ? bounds.encode(mesh.positions[vertex]) : mesh.positions[vertex];
+}
+
+template<typename Attribute>
+typename Attribute::value_type AttributeValue(const MeshData& mesh, const MeshBounds&,
+                                              size_t vertex, std::integral_constant<GLuint, colorLocation>)
+{
+    return mesh.colors.empty() ? glm::vec4{1.0f} : mesh.colors[vertex];
+}
+
+template<typename Attribute>
+typename Attribute::value_type AttributeValue(const MeshData& mesh, const MeshBounds&,
+                                              size_t vertex, std::integral_constant<GLuint, normalLocation>)
+{
+    return mesh.normals.empty() ? glm::vec3{0.0f, 0.0f, 1.0f} : mesh.normals[vertex];
+}
+
+template<typename Format>
+struct VertexEncoder;
+
+template<typename... Attributes>
+struct VertexEncoder<VertexFormat<Attributes...>> {
+    using Vertex = typename VertexFormat<Attributes...>::Vertex;
+
+    static Vertex encode(const MeshData& mesh, const MeshBounds& bounds, size_t vertex)
+    {
+        return Vertex{AttributeValue<Attributes>(mesh, bounds, vertex,
+                                                 std::integral_constant<GLuint, Attributes::location>{})...};
+    }
+};
+
+} // detail
+
+// packs every vertex of mesh into Format, bounds must be the ones the shader
+// decodes with when the position is boundsRelative
+template<typename Format>
+std::vector<typename Format::Vertex> EncodeVertices(const MeshData& mesh, const MeshBounds& bounds)
+{
+    std::vector<typename Format::Vertex> vertexes;
+    vertexes.reserve(mesh.positions.size());
+
+    for (size_t i = 0; i < mesh.positions.size(); ++i)
+        vertexes.push_back(detail::VertexEncoder<Format>::encode(mesh, bounds, i));
+
+    return vertexes;
+}
+
+// largest round trip error of a format over mesh: world units for positions,
+// degrees for normals, [0, 1] units for colors
+template<typename Format, typename PositionAttribute, typename ColorAttribute, typename NormalAttribute>
+EncodingError MeasureEncodingError(const MeshData& mesh, const MeshBounds& bounds)
+{
+    EncodingError error{0.0f, 0.0f, 0.0f};
+    const auto vertexes = EncodeVertices<Format>(mesh, bounds);
+
+    for (size_t i = 0; i < vertexes.size(); ++i)
+    {
+        auto position = vertexes[i].template get<PositionAttribute>();
+        if (PositionAttribute::boundsRelative)
+            position = bounds.decode(position);
+
+        error.position = std::max(error.position, glm::length(position - mesh.positions[i]));
+
+        if (!mesh.normals.empty())
+        {
+            // the chord keeps its precision where acos of a dot product doesn't
+            const auto normal = glm::normalize(vertexes[i].template get<NormalAttribute>());
+            const auto chord = glm::length(normal - glm::normalize(mesh.normals[i]));
+            error.normalDegrees = std::max(error.normalDegrees,
+                                           glm::degrees(2.0f * std::asin(std::min(chord * 0.5f, 1.0f))));
+        }
+
+        if (!mesh.colors.empty())
+        {
+            const auto color = vertexes[i].template get<ColorAttribute>();
+            for (int c = 0; c < ColorAttribute::components; ++c)
+                error.color = std::max(error.color, std::abs(color[c] - mesh.colors[i][c]));
+        }
+    }
+
+    return error;
+}
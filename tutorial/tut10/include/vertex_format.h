@@ -0,0 +1,394 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// every vertex format and shader agree on these, 2-5 are taken by the
+// per-instance world matrix
+enum AttributeLocation : GLuint {
+    positionLocation = 0,
+    colorLocation = 1,
+    instanceLocation = 2,
+    normalLocation = 6
+};
+
+// scalar codecs used by the compressed attributes, see vertex_format.cpp
+std::uint16_t FloatToHalf(float value) noexcept;
+float HalfToFloat(std::uint16_t half) noexcept;
+
+// unit vector to a point of the [-1, 1] square and back
+glm::vec2 OctahedralEncode(const glm::vec3& normal) noexcept;
+glm::vec3 OctahedralDecode(const glm::vec2& encoded) noexcept;
+
+// An attribute describes its GL layout and how a value is packed into (and
+// read back from) the bytes of a vertex. Positions flagged boundsRelative
+// take the position mapped into the mesh bounds, [-1, 1] on every axis, the
+// vertex shader maps them back.
+
+struct Position3f {
+    using value_type = glm::vec3;
+
+    static constexpr GLuint location = positionLocation;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static constexpr size_t size = 3 * sizeof(float);
+    static constexpr bool boundsRelative = false;
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        const float data[] = {value.x, value.y, value.z};
+        std::memcpy(dst, data, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        float data[3];
+        std::memcpy(data, src, size);
+        return value_type{data[0], data[1], data[2]};
+    }
+};
+
+// signed normalized 16 bit, padded to 8 bytes to keep the next attribute aligned
+struct Position3s16n {
+    using value_type = glm::vec3;
+
+    static constexpr GLuint location = positionLocation;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t size = 4 * sizeof(std::int16_t);
+    static constexpr bool boundsRelative = true;
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        std::int16_t data[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 3; ++i)
+            data[i] = static_cast<std::int16_t>(std::lround(std::min(std::max(value[i], -1.0f), 1.0f) * 32767.0f));
+
+        std::memcpy(dst, data, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        std::int16_t data[4];
+        std::memcpy(data, src, size);
+        return value_type(data[0], data[1], data[2]) / 32767.0f;
+    }
+};
+
+// half floats, padded to 8 bytes like Position3s16n
+struct Position3h {
+    using value_type = glm::vec3;
+
+    static constexpr GLuint location = positionLocation;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_HALF_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static constexpr size_t size = 4 * sizeof(std::uint16_t);
+    static constexpr bool boundsRelative = true;
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        const std::uint16_t data[4] = {FloatToHalf(value.x), FloatToHalf(value.y), FloatToHalf(value.z), 0};
+        std::memcpy(dst, data, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        std::uint16_t data[4];
+        std::memcpy(data, src, size);
+        return value_type{HalfToFloat(data[0]), HalfToFloat(data[1]), HalfToFloat(data[2])};
+    }
+};
+
+// the uncompressed layout of the older tutorials, alpha is dropped
+struct Color3f {
+    using value_type = glm::vec4;
+
+    static constexpr GLuint location = colorLocation;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static constexpr size_t size = 3 * sizeof(float);
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        const float data[] = {value.x, value.y, value.z};
+        std::memcpy(dst, data, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        float data[3];
+        std::memcpy(data, src, size);
+        return value_type{data[0], data[1], data[2], 1.0f};
+    }
+};
+
+// rgba in [0, 1] stored as normalized unsigned bytes
+struct Color4u8n {
+    using value_type = glm::vec4;
+
+    static constexpr GLuint location = colorLocation;
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t size = 4;
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        std::uint8_t data[4];
+        for (int i = 0; i < 4; ++i)
+            data[i] = static_cast<std::uint8_t>(std::lround(std::min(std::max(value[i], 0.0f), 1.0f) * 255.0f));
+
+        std::memcpy(dst, data, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        std::uint8_t data[4];
+        std::memcpy(data, src, size);
+        return value_type(data[0], data[1], data[2], data[3]) / 255.0f;
+    }
+};
+
+// unit vector as three signed normalized 10 bit fields, w is left at zero
+struct Normal1010102 {
+    using value_type = glm::vec3;
+
+    static constexpr GLuint location = normalLocation;
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t size = 4;
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        std::uint32_t packed = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const auto field = std::lround(std::min(std::max(value[i], -1.0f), 1.0f) * 511.0f);
+            packed |= (static_cast<std::uint32_t>(field) & 0x3ffu) << (10 * i);
+        }
+
+        std::memcpy(dst, &packed, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        std::uint32_t packed;
+        std::memcpy(&packed, src, size);
+
+        value_type value;
+        for (int i = 0; i < 3; ++i)
+        {
+            // sign extend the field, -512 clamps to -1 like GL does
+            auto field = static_cast<std::int32_t>((packed >> (10 * i)) & 0x3ffu);
+            if (field & 0x200)
+                field -= 0x400;
+
+            value[i] = std::max(field / 511.0f, -1.0f);
+        }
+
+        return value;
+    }
+};
+
+struct Normal3f {
+    using value_type = glm::vec3;
+
+    static constexpr GLuint location = normalLocation;
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+    static constexpr size_t size = 3 * sizeof(float);
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        Position3f::pack(dst, value);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        return Position3f::unpack(src);
+    }
+};
+
+// octahedral encoded unit vector in two signed normalized 16 bit values, the
+// shader has to decode it (OctahedralDecode in the vertex shader)
+struct NormalOct16 {
+    using value_type = glm::vec3;
+
+    static constexpr GLuint location = normalLocation;
+    static constexpr GLint components = 2;
+    static constexpr GLenum type = GL_SHORT;
+    static constexpr GLboolean normalized = GL_TRUE;
+    static constexpr size_t size = 2 * sizeof(std::int16_t);
+
+    static void pack(void* dst, const value_type& value) noexcept
+    {
+        const auto encoded = OctahedralEncode(value);
+        const std::int16_t data[] = {
+            static_cast<std::int16_t>(std::lround(encoded.x * 32767.0f)),
+            static_cast<std::int16_t>(std::lround(encoded.y * 32767.0f))
+        };
+
+        std::memcpy(dst, data, size);
+    }
+
+    static value_type unpack(const void* src) noexcept
+    {
+        std::int16_t data[2];
+        std::memcpy(data, src, size);
+        return OctahedralDecode(glm::vec2{data[0] / 32767.0f, data[1] / 32767.0f});
+    }
+};
+
+namespace detail {
+
+template<typename Attribute, typename... Attributes>
+constexpr size_t AttributeIndex()
+{
+    constexpr bool matches[] = {false, std::is_same<Attribute, Attributes>::value...};
+
+    for (size_t i = 1; i <= sizeof...(Attributes); ++i)
+        if (matches[i])
+            return i - 1;
+
+    return sizeof...(Attributes);
+}
+
+template<typename Attribute, typename... Attributes>
+constexpr size_t AttributeCount()
+{
+    constexpr bool matches[] = {false, std::is_same<Attribute, Attributes>::value...};
+
+    size_t count = 0;
+    for (auto match : matches)
+        count += match ? 1 : 0;
+
+    return count;
+}
+
+template<typename... Attributes>
+constexpr size_t AttributeOffset(size_t index)
+{
+    constexpr size_t sizes[] = {0, Attributes::size...};
+
+    size_t offset = 0;
+    for (size_t i = 1; i <= index; ++i)
+        offset += sizes[i];
+
+    return offset;
+}
+
+// FNV-1a over location, components, type, normalization and size of every
+// attribute: equal for two formats only when their bytes mean the same
+template<typename... Attributes>
+constexpr std::uint64_t LayoutHash()
+{
+    constexpr std::uint64_t fields[] = {0,
+        (std::uint64_t(Attributes::location) |
+         std::uint64_t(Attributes::components) << 8 |
+         std::uint64_t(Attributes::type) << 16 |
+         std::uint64_t(Attributes::normalized) << 48 |
+         std::uint64_t(Attributes::size) << 56)...
+    };
+
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 1; i <= sizeof...(Attributes); ++i)
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            hash ^= (fields[i] >> (8 * byte)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+
+    return hash;
+}
+
+} // detail
+
+// Interleaved vertex layout known at compile time: the attributes are stored
+// in the order given, back to back, so stride and offsets are constants and
+// setup() is the only place glVertexAttribPointer is called for a mesh.
+//
+//     using CubeFormat = VertexFormat<Position3f, Color4u8n>;
+//     CubeFormat::Vertex v{glm::vec3{0.0f}, glm::vec4{1.0f}};
+template<typename... Attributes>
+class VertexFormat {
+public:
+    static_assert(sizeof...(Attributes) > 0, "A vertex needs at least one attribute");
+
+    static constexpr size_t stride = detail::AttributeOffset<Attributes...>(sizeof...(Attributes));
+
+    // identifies the layout in files, see mesh_file.h
+    static constexpr std::uint64_t layout = detail::LayoutHash<Attributes...>();
+
+    template<typename Attribute>
+    static constexpr size_t offset() noexcept
+    {
+        static_assert(detail::AttributeCount<Attribute, Attributes...>() == 1,
+                      "The attribute must appear exactly once in the format");
+
+        return detail::AttributeOffset<Attributes...>(detail::AttributeIndex<Attribute, Attributes...>());
+    }
+
+    class Vertex {
+    public:
+        Vertex() noexcept
+        {
+            std::memset(m_bytes, 0, sizeof(m_bytes));
+        }
+
+        Vertex(const typename Attributes::value_type&... values) noexcept
+        {
+            int expand[] = {0, (set<Attributes>(values), 0)...};
+            (void)expand;
+        }
+
+        template<typename Attribute>
+        Vertex& set(const typename Attribute::value_type& value) noexcept
+        {
+            Attribute::pack(m_bytes + offset<Attribute>(), value);
+            return *this;
+        }
+
+        template<typename Attribute>
+        typename Attribute::value_type get() const noexcept
+        {
+            return Attribute::unpack(m_bytes + offset<Attribute>());
+        }
+
+    private:
+        unsigned char m_bytes[stride];
+    };
+
+    static_assert(sizeof(Vertex) == stride, "Vertex must not be padded");
+
+    // points every attribute at the buffer bound to GL_ARRAY_BUFFER, the
+    // vertex array that records them must be bound as well
+    static void setup(GLintptr base = 0)
+    {
+        int expand[] = {0, (enable<Attributes>(base), 0)...};
+        (void)expand;
+    }
+
+private:
+    template<typename Attribute>
+    static void enable(GLintptr base)
+    {
+        static_assert(offset<Attribute>() % 4 == 0, "Attributes must be 4 byte aligned");
+
+        glEnableVertexAttribArray(Attribute::location);
+        glVertexAttribPointer(
+                    Attribute::location, Attribute::components, Attribute::type, Attribute::normalized,
+                    stride, (GLvoid*)(base + offset<Attribute>())
+                    );
+    }
+};
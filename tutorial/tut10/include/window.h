@@ -0,0 +1,35 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <string>
+
+enum class WindowBackend {sdl, headless};
+
+// The sdl backend owns an SDL window and its GL context, the headless one an
+// EGL context (surfaceless or pbuffer) that renders into an offscreen FBO.
+// Both expose the same 4.5 core profile to the rest of the program.
+struct Window {
+    WindowBackend backend;
+    int width;
+    int height;
+
+    SDL_Window* sdlWindow;
+    SDL_GLContext sdlContext;
+
+    void* eglDisplay;
+    void* eglContext;
+    void* eglSurface;
+
+    GLuint fbo;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+};
+
+Window InitializeWindow(int width, int height, const std::string& title,
+                        WindowBackend backend = WindowBackend::sdl);
+void InitGrapics(Window& window);
+void SetViewport(int width, int height);
+void SwapWindow(Window& window);
+void SetVSync(Window& window, bool enabled);
+void DestroyWindow(Window& window);
@@ -0,0 +1,523 @@
+#include "batch_math.h"
+#include <ostream>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_MATH_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "The kernels read glm::mat4 as 16 floats");
+static_assert(sizeof(glm::mat4x3) == 12 * sizeof(float), "The kernels read glm::mat4x3 as 12 floats");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "The kernels read glm::vec3 as 3 floats");
+
+namespace detail {
+
+// all kernels work on the floats, column major like glm
+struct MathKernelTable {
+    void (*multiplyShared)(const float* a, const float* b, float* out, size_t count);
+    void (*multiply)(const float* a, const float* b, float* out, size_t count);
+    void (*multiplyAffine)(const float* a, const float* b, float* out, size_t count);
+    void (*transformPoints)(const float* m, const float* points, float* out, size_t count);
+};
+
+// the reference, and the tail of every other kernel
+
+void MultiplySharedGlm(const float* a, const float* b, float* out, size_t count)
+{
+    const auto left = *reinterpret_cast<const glm::mat4*>(a);
+    for (size_t i = 0; i < count; ++i)
+        reinterpret_cast<glm::mat4*>(out)[i] = left * reinterpret_cast<const glm::mat4*>(b)[i];
+}
+
+void MultiplyGlm(const float* a, const float* b, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        reinterpret_cast<glm::mat4*>(out)[i] =
+            reinterpret_cast<const glm::mat4*>(a)[i] * reinterpret_cast<const glm::mat4*>(b)[i];
+}
+
+void MultiplyAffineGlm(const float* a, const float* b, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        reinterpret_cast<glm::mat4x3*>(out)[i] = glm::mat4x3(
+            glm::mat4(reinterpret_cast<const glm::mat4x3*>(a)[i]) *
+            glm::mat4(reinterpret_cast<const glm::mat4x3*>(b)[i]));
+}
+
+void TransformPointsGlm(const float* m, const float* points, float* out, size_t count)
+{
+    const auto matrix = *reinterpret_cast<const glm::mat4*>(m);
+    for (size_t i = 0; i < count; ++i)
+        reinterpret_cast<glm::vec3*>(out)[i] =
+            glm::vec3(matrix * glm::vec4(reinterpret_cast<const glm::vec3*>(points)[i], 1.0f));
+}
+
+#ifdef BATCH_MATH_X86
+
+// glm's order: a matrix product sums its four terms left to right, a
+// matrix times a vector adds them in pairs, and every term of the affine
+// product is kept, times the 0 or 1 of the missing row, so even the sign
+// of a zero comes out the same
+
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+#define BROADCAST(v, k) _mm_shuffle_ps(v, v, _MM_SHUFFLE(k, k, k, k))
+#define BROADCAST256(v, k) _mm256_shuffle_ps(v, v, _MM_SHUFFLE(k, k, k, k))
+#define BROADCAST512(v, k) _mm512_permute_ps(v, _MM_SHUFFLE(k, k, k, k))
+
+SSE41 inline __m128 Sum4(__m128 a0, __m128 b0, __m128 a1, __m128 b1, __m128 a2, __m128 b2, __m128 a3, __m128 b3)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, b0), _mm_mul_ps(a1, b1)), _mm_mul_ps(a2, b2)),
+                      _mm_mul_ps(a3, b3));
+}
+
+// columns of a 4x3 matrix, the fourth lane is whatever came next
+SSE41 inline void LoadAffine(const float* m, __m128 columns[4])
+{
+    const auto v0 = _mm_loadu_ps(m);
+    const auto v1 = _mm_loadu_ps(m + 4);
+    const auto v2 = _mm_loadu_ps(m + 8);
+    const auto t = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 0, 3, 3));
+
+    columns[0] = v0;
+    columns[1] = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 2, 0));
+    columns[2] = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(0, 0, 3, 2));
+    columns[3] = _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(3, 3, 2, 1));
+}
+
+SSE41 inline void StoreAffine(float* m, const __m128 columns[4])
+{
+    const auto x1 = _mm_shuffle_ps(columns[1], columns[1], _MM_SHUFFLE(0, 0, 0, 0));
+    const auto z2 = _mm_shuffle_ps(columns[2], columns[2], _MM_SHUFFLE(2, 2, 2, 2));
+    const auto c3 = _mm_shuffle_ps(columns[3], columns[3], _MM_SHUFFLE(2, 1, 0, 0));
+
+    _mm_storeu_ps(m, _mm_blend_ps(columns[0], x1, 0x8));
+    _mm_storeu_ps(m + 4, _mm_shuffle_ps(columns[1], columns[2], _MM_SHUFFLE(1, 0, 2, 1)));
+    _mm_storeu_ps(m + 8, _mm_blend_ps(c3, z2, 0x1));
+}
+
+SSE41 inline void MultiplyAffine1(const __m128 a[4], const float* b, float* out)
+{
+    const auto zero = _mm_setzero_ps();
+    const auto one = _mm_set1_ps(1.0f);
+
+    __m128 r[4];
+    for (int j = 0; j < 4; ++j)
+        r[j] = Sum4(a[0], _mm_set1_ps(b[j * 3]), a[1], _mm_set1_ps(b[j * 3 + 1]),
+                    a[2], _mm_set1_ps(b[j * 3 + 2]), a[3], j == 3 ? one : zero);
+
+    StoreAffine(out, r);
+}
+
+SSE41 void MultiplySharedSse41(const float* a, const float* b, float* out, size_t count)
+{
+    const auto a0 = _mm_loadu_ps(a);
+    const auto a1 = _mm_loadu_ps(a + 4);
+    const auto a2 = _mm_loadu_ps(a + 8);
+    const auto a3 = _mm_loadu_ps(a + 12);
+
+    for (size_t i = 0; i < count; ++i, b += 16, out += 16)
+    {
+        __m128 r[4];
+        for (int j = 0; j < 4; ++j)
+        {
+            const auto bj = _mm_loadu_ps(b + j * 4);
+            r[j] = Sum4(a0, BROADCAST(bj, 0), a1, BROADCAST(bj, 1), a2, BROADCAST(bj, 2), a3, BROADCAST(bj, 3));
+        }
+
+        for (int j = 0; j < 4; ++j)
+            _mm_storeu_ps(out + j * 4, r[j]);
+    }
+}
+
+SSE41 void MultiplySse41(const float* a, const float* b, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, a += 16, b += 16, out += 16)
+    {
+        const auto a0 = _mm_loadu_ps(a);
+        const auto a1 = _mm_loadu_ps(a + 4);
+        const auto a2 = _mm_loadu_ps(a + 8);
+        const auto a3 = _mm_loadu_ps(a + 12);
+
+        __m128 r[4];
+        for (int j = 0; j < 4; ++j)
+        {
+            const auto bj = _mm_loadu_ps(b + j * 4);
+            r[j] = Sum4(a0, BROADCAST(bj, 0), a1, BROADCAST(bj, 1), a2, BROADCAST(bj, 2), a3, BROADCAST(bj, 3));
+        }
+
+        for (int j = 0; j < 4; ++j)
+            _mm_storeu_ps(out + j * 4, r[j]);
+    }
+}
+
+SSE41 void MultiplyAffineSse41(const float* a, const float* b, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, a += 12, b += 12, out += 12)
+    {
+        __m128 columns[4];
+        LoadAffine(a, columns);
+        MultiplyAffine1(columns, b, out);
+    }
+}
+
+SSE41 void TransformPointsSse41(const float* m, const float* points, float* out, size_t count)
+{
+    const auto m0 = _mm_loadu_ps(m);
+    const auto m1 = _mm_loadu_ps(m + 4);
+    const auto m2 = _mm_loadu_ps(m + 8);
+    const auto m3 = _mm_loadu_ps(m + 12);
+
+    for (size_t i = 0; i < count; ++i, points += 3, out += 3)
+    {
+        const auto xy = _mm_add_ps(_mm_mul_ps(m0, _mm_set1_ps(points[0])), _mm_mul_ps(m1, _mm_set1_ps(points[1])));
+        const auto zw = _mm_add_ps(_mm_mul_ps(m2, _mm_set1_ps(points[2])), m3);
+        const auto r = _mm_add_ps(xy, zw);
+
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), r);
+        _mm_store_ss(out + 2, _mm_movehl_ps(r, r));
+    }
+}
+
+// two columns, or two matrices, per register
+
+AVX2 inline __m256 Sum4(__m256 a0, __m256 b0, __m256 a1, __m256 b1, __m256 a2, __m256 b2, __m256 a3, __m256 b3)
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a0, b0), _mm256_mul_ps(a1, b1)),
+                                       _mm256_mul_ps(a2, b2)),
+                         _mm256_mul_ps(a3, b3));
+}
+
+AVX2 inline void MultiplyColumns(__m256 a0, __m256 a1, __m256 a2, __m256 a3, const float* b, float* out)
+{
+    const auto b01 = _mm256_loadu_ps(b);
+    const auto b23 = _mm256_loadu_ps(b + 8);
+
+    const auto r01 = Sum4(a0, BROADCAST256(b01, 0), a1, BROADCAST256(b01, 1),
+                          a2, BROADCAST256(b01, 2), a3, BROADCAST256(b01, 3));
+    const auto r23 = Sum4(a0, BROADCAST256(b23, 0), a1, BROADCAST256(b23, 1),
+                          a2, BROADCAST256(b23, 2), a3, BROADCAST256(b23, 3));
+
+    _mm256_storeu_ps(out, r01);
+    _mm256_storeu_ps(out + 8, r23);
+}
+
+AVX2 void MultiplySharedAvx2(const float* a, const float* b, float* out, size_t count)
+{
+    const auto a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+    const auto a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    const auto a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    const auto a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+    for (size_t i = 0; i < count; ++i, b += 16, out += 16)
+        MultiplyColumns(a0, a1, a2, a3, b, out);
+}
+
+AVX2 void MultiplyAvx2(const float* a, const float* b, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, a += 16, b += 16, out += 16)
+    {
+        const auto a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+        const auto a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+        const auto a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+        const auto a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+        MultiplyColumns(a0, a1, a2, a3, b, out);
+    }
+}
+
+AVX2 void MultiplyAffineAvx2(const float* a, const float* b, float* out, size_t count)
+{
+    // columns 0 and 1 in one register, 2 and 3 in the other, each stored
+    // back as six floats
+    const auto mask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+    const auto lowIndex = _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3);
+    const auto highIndex = _mm256_setr_epi32(2, 2, 2, 2, 5, 5, 5, 5);
+    const auto w01 = _mm256_setzero_ps();
+    const auto w23 = _mm256_setr_ps(0, 0, 0, 0, 1, 1, 1, 1);
+    const auto pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+    for (size_t i = 0; i < count; ++i, a += 12, b += 12, out += 12)
+    {
+        __m128 columns[4];
+        LoadAffine(a, columns);
+
+        __m256 a4[4];
+        for (int k = 0; k < 4; ++k)
+            a4[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(columns[k]), columns[k], 1);
+
+        const auto low = _mm256_loadu_ps(b);
+        const auto high = _mm256_loadu_ps(b + 4);
+
+        __m256 terms01[3];
+        __m256 terms23[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            const auto step = _mm256_set1_epi32(k);
+            terms01[k] = _mm256_permutevar8x32_ps(low, _mm256_add_epi32(lowIndex, step));
+            terms23[k] = _mm256_permutevar8x32_ps(high, _mm256_add_epi32(highIndex, step));
+        }
+
+        const auto r01 = Sum4(a4[0], terms01[0], a4[1], terms01[1], a4[2], terms01[2], a4[3], w01);
+        const auto r23 = Sum4(a4[0], terms23[0], a4[1], terms23[1], a4[2], terms23[2], a4[3], w23);
+
+        _mm256_maskstore_ps(out, mask, _mm256_permutevar8x32_ps(r01, pack));
+        _mm256_maskstore_ps(out + 6, mask, _mm256_permutevar8x32_ps(r23, pack));
+    }
+}
+
+AVX2 void TransformPointsAvx2(const float* m, const float* points, float* out, size_t count)
+{
+    const auto m0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+    const auto m1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+    const auto m2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+    const auto m3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+
+    // two points in, the xyz of both out as six floats
+    const auto mask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+    const auto xIndex = _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3);
+    const auto yIndex = _mm256_setr_epi32(1, 1, 1, 1, 4, 4, 4, 4);
+    const auto zIndex = _mm256_setr_epi32(2, 2, 2, 2, 5, 5, 5, 5);
+    const auto pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2, points += 6, out += 6)
+    {
+        const auto p = _mm256_maskload_ps(points, mask);
+        const auto x = _mm256_permutevar8x32_ps(p, xIndex);
+        const auto y = _mm256_permutevar8x32_ps(p, yIndex);
+        const auto z = _mm256_permutevar8x32_ps(p, zIndex);
+
+        const auto xy = _mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m1, y));
+        const auto zw = _mm256_add_ps(_mm256_mul_ps(m2, z), m3);
+        _mm256_maskstore_ps(out, mask, _mm256_permutevar8x32_ps(_mm256_add_ps(xy, zw), pack));
+    }
+
+    TransformPointsSse41(m, points, out, count - i);
+}
+
+// a whole matrix, or four matrices or points, per register
+
+AVX512 inline __m512 Sum4(__m512 a0, __m512 b0, __m512 a1, __m512 b1, __m512 a2, __m512 b2, __m512 a3, __m512 b3)
+{
+    return _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(a0, b0), _mm512_mul_ps(a1, b1)),
+                                       _mm512_mul_ps(a2, b2)),
+                         _mm512_mul_ps(a3, b3));
+}
+
+AVX512 void MultiplySharedAvx512(const float* a, const float* b, float* out, size_t count)
+{
+    const auto a0 = _mm512_broadcast_f32x4(_mm_loadu_ps(a));
+    const auto a1 = _mm512_broadcast_f32x4(_mm_loadu_ps(a + 4));
+    const auto a2 = _mm512_broadcast_f32x4(_mm_loadu_ps(a + 8));
+    const auto a3 = _mm512_broadcast_f32x4(_mm_loadu_ps(a + 12));
+
+    for (size_t i = 0; i < count; ++i, b += 16, out += 16)
+    {
+        const auto bm = _mm512_loadu_ps(b);
+        _mm512_storeu_ps(out, Sum4(a0, BROADCAST512(bm, 0), a1, BROADCAST512(bm, 1),
+                                   a2, BROADCAST512(bm, 2), a3, BROADCAST512(bm, 3)));
+    }
+}
+
+AVX512 void MultiplyAvx512(const float* a, const float* b, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, a += 16, b += 16, out += 16)
+    {
+        const auto a0 = _mm512_broadcast_f32x4(_mm_loadu_ps(a));
+        const auto a1 = _mm512_broadcast_f32x4(_mm_loadu_ps(a + 4));
+        const auto a2 = _mm512_broadcast_f32x4(_mm_loadu_ps(a + 8));
+        const auto a3 = _mm512_broadcast_f32x4(_mm_loadu_ps(a + 12));
+        const auto bm = _mm512_loadu_ps(b);
+
+        _mm512_storeu_ps(out, Sum4(a0, BROADCAST512(bm, 0), a1, BROADCAST512(bm, 1),
+                                   a2, BROADCAST512(bm, 2), a3, BROADCAST512(bm, 3)));
+    }
+}
+
+AVX512 void MultiplyAffineAvx512(const float* a, const float* b, float* out, size_t count)
+{
+    // one matrix per register, a column in each quarter like the 4x4 kernels
+    const auto bIndex = _mm512_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3, 6, 6, 6, 6, 9, 9, 9, 9);
+    const auto one = _mm512_set1_epi32(1);
+    const auto w = _mm512_setr_ps(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1);
+    const auto pack = _mm512_setr_epi32(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0, 0, 0, 0);
+
+    for (size_t i = 0; i < count; ++i, a += 12, b += 12, out += 12)
+    {
+        __m128 columns[4];
+        LoadAffine(a, columns);
+
+        const auto bm = _mm512_maskz_loadu_ps(0x0fff, b);
+        const auto b0 = _mm512_permutexvar_ps(bIndex, bm);
+        const auto b1 = _mm512_permutexvar_ps(_mm512_add_epi32(bIndex, one), bm);
+        const auto b2 = _mm512_permutexvar_ps(_mm512_add_epi32(bIndex, _mm512_add_epi32(one, one)), bm);
+
+        const auto r = Sum4(_mm512_broadcast_f32x4(columns[0]), b0, _mm512_broadcast_f32x4(columns[1]), b1,
+                            _mm512_broadcast_f32x4(columns[2]), b2, _mm512_broadcast_f32x4(columns[3]), w);
+        _mm512_mask_storeu_ps(out, 0x0fff, _mm512_permutexvar_ps(pack, r));
+    }
+}
+
+AVX512 void TransformPointsAvx512(const float* m, const float* points, float* out, size_t count)
+{
+    const auto m0 = _mm512_broadcast_f32x4(_mm_loadu_ps(m));
+    const auto m1 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 4));
+    const auto m2 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 8));
+    const auto m3 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 12));
+
+    // four points in, the xyz of all four out as twelve floats
+    const auto xIndex = _mm512_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3, 6, 6, 6, 6, 9, 9, 9, 9);
+    const auto one = _mm512_set1_epi32(1);
+    const auto pack = _mm512_setr_epi32(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0, 0, 0, 0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, points += 12, out += 12)
+    {
+        const auto p = _mm512_maskz_loadu_ps(0x0fff, points);
+        const auto x = _mm512_permutexvar_ps(xIndex, p);
+        const auto y = _mm512_permutexvar_ps(_mm512_add_epi32(xIndex, one), p);
+        const auto z = _mm512_permutexvar_ps(_mm512_add_epi32(xIndex, _mm512_add_epi32(one, one)), p);
+
+        const auto xy = _mm512_add_ps(_mm512_mul_ps(m0, x), _mm512_mul_ps(m1, y));
+        const auto zw = _mm512_add_ps(_mm512_mul_ps(m2, z), m3);
+        _mm512_mask_storeu_ps(out, 0x0fff, _mm512_permutexvar_ps(pack, _mm512_add_ps(xy, zw)));
+    }
+
+    TransformPointsSse41(m, points, out, count - i);
+}
+
+#undef SSE41
+#undef AVX2
+#undef AVX512
+#undef BROADCAST
+#undef BROADCAST256
+#undef BROADCAST512
+
+const MathKernelTable mathKernels[] = {
+    {MultiplySharedGlm, MultiplyGlm, MultiplyAffineGlm, TransformPointsGlm},
+    {MultiplySharedSse41, MultiplySse41, MultiplyAffineSse41, TransformPointsSse41},
+    {MultiplySharedAvx2, MultiplyAvx2, MultiplyAffineAvx2, TransformPointsAvx2},
+    {MultiplySharedAvx512, MultiplyAvx512, MultiplyAffineAvx512, TransformPointsAvx512},
+};
+
+#else
+
+const MathKernelTable mathKernels[] = {
+    {MultiplySharedGlm, MultiplyGlm, MultiplyAffineGlm, TransformPointsGlm},
+};
+
+#endif
+
+MathKernel BestMathKernel()
+{
+    for (auto kernel : {MathKernel::avx512, MathKernel::avx2, MathKernel::sse41})
+        if (SupportsMathKernel(kernel))
+            return kernel;
+
+    return MathKernel::glm;
+}
+
+MathKernel& SelectedMathKernel()
+{
+    static auto kernel = BestMathKernel();
+    return kernel;
+}
+
+const MathKernelTable& CurrentMathKernels()
+{
+    return mathKernels[static_cast<int>(SelectedMathKernel())];
+}
+
+} // detail
+
+ostream& operator << (ostream& out, MathKernel kernel)
+{
+    switch (kernel)
+    {
+    case MathKernel::glm:
+        return out << "glm";
+    case MathKernel::sse41:
+        return out << "sse4.1";
+    case MathKernel::avx2:
+        return out << "avx2";
+    case MathKernel::avx512:
+        return out << "avx512";
+    }
+
+    return out << "unknown";
+}
+
+bool SupportsMathKernel(MathKernel kernel)
+{
+#ifdef BATCH_MATH_X86
+    switch (kernel)
+    {
+    case MathKernel::glm:
+        return true;
+    case MathKernel::sse41:
+        return __builtin_cpu_supports("sse4.1");
+    case MathKernel::avx2:
+        return __builtin_cpu_supports("avx2");
+    case MathKernel::avx512:
+        return __builtin_cpu_supports("avx512f");
+    }
+
+    return false;
+#else
+    return kernel == MathKernel::glm;
+#endif
+}
+
+MathKernel CurrentMathKernel()
+{
+    return detail::SelectedMathKernel();
+}
+
+void SetMathKernel(MathKernel kernel)
+{
+    if (!SupportsMathKernel(kernel))
+        throw invalid_argument{"The CPU doesn't run this math kernel"};
+
+    detail::SelectedMathKernel() = kernel;
+}
+
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    if (!count)
+        return;
+
+    // a copy, out may overwrite a
+    const auto left = a;
+    detail::CurrentMathKernels().multiplyShared(&left[0][0], &b[0][0][0], &out[0][0][0], count);
+}
+
+void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, size_t count)
+{
+    if (!count)
+        return;
+
+    detail::CurrentMathKernels().multiply(&a[0][0][0], &b[0][0][0], &out[0][0][0], count);
+}
+
+void MultiplyAffine(const glm::mat4x3* a, const glm::mat4x3* b, glm::mat4x3* out, size_t count)
+{
+    if (!count)
+        return;
+
+    detail::CurrentMathKernels().multiplyAffine(&a[0][0][0], &b[0][0][0], &out[0][0][0], count);
+}
+
+void TransformPoints(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, size_t count)
+{
+    if (!count)
+        return;
+
+    const auto matrix = m;
+    detail::CurrentMathKernels().transformPoints(&matrix[0][0], &points[0][0], &out[0][0], count);
+}
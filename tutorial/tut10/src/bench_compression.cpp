@@ -0,0 +1,140 @@
+#include "benchmark.h"
+#include "programs.h"
+#include "uniforms.h"
+#include "vertex_compression.h"
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+struct CompressionScene {
+    MeshData mesh;
+    MeshBounds bounds;
+    UniformBuffer frame;
+    UniformArena objects;
+};
+
+// the layout every tutorial used so far
+struct FloatLayout {
+    using Position = Position3f;
+    using Color = Color3f;
+    using Normal = Normal3f;
+    using Format = VertexFormat<Position, Color, Normal>;
+
+    static constexpr const char* name = "float";
+    static constexpr NormalEncoding normals = NormalEncoding::vector;
+};
+
+struct Snorm16Layout {
+    using Position = Position3s16n;
+    using Color = Color4u8n;
+    using Normal = Normal1010102;
+    using Format = VertexFormat<Position, Color, Normal>;
+
+    static constexpr const char* name = "snorm16";
+    static constexpr NormalEncoding normals = NormalEncoding::vector;
+};
+
+struct HalfLayout {
+    using Position = Position3h;
+    using Color = Color4u8n;
+    using Normal = Normal1010102;
+    using Format = VertexFormat<Position, Color, Normal>;
+
+    static constexpr const char* name = "half";
+    static constexpr NormalEncoding normals = NormalEncoding::vector;
+};
+
+struct OctahedralLayout {
+    using Position = Position3s16n;
+    using Color = Color4u8n;
+    using Normal = NormalOct16;
+    using Format = VertexFormat<Position, Color, Normal>;
+
+    static constexpr const char* name = "octahedral";
+    static constexpr NormalEncoding normals = NormalEncoding::octahedral;
+};
+
+template<typename Layout>
+void MeasureLayout(ostream& json, Window& window, const Camera& camera,
+                   const BenchmarkSettings& settings, CompressionScene& scene)
+{
+    using Format = typename Layout::Format;
+
+    const auto bounds = Layout::Position::boundsRelative ? scene.bounds : IdentityBounds();
+    const auto error = MeasureEncodingError<Format, typename Layout::Position,
+                                            typename Layout::Color, typename Layout::Normal>(scene.mesh, bounds);
+
+    auto mesh = CreateMesh<Format>(EncodeVertices<Format>(scene.mesh, bounds), scene.mesh.indices);
+    auto program = CreateLitGPUProgram(Layout::normals);
+    program.setBounds(bounds);
+
+    const auto timings = MeasureFrames(window, settings, [&](int frame)
+    {
+        UpdateFrameUniforms(scene.frame, camera, frame * 0.01f);
+        scene.objects.nextFrame();
+
+        program.enable();
+
+        for (int draw = 0; draw < meshBenchmarkDraws; ++draw)
+        {
+            const auto offset = scene.objects.push(ObjectUniforms{MeshBenchmarkTransform(draw, frame)});
+            scene.objects.bind<ObjectUniforms>(offset);
+            DrawMesh(mesh);
+        }
+
+        program.disable();
+    });
+
+    const auto indexBytes = IndexSize(mesh.indexType) * mesh.count;
+    DestroyTriangleBuffer(mesh);
+
+    const auto triangles = double(scene.mesh.indices.size() / 3) * meshBenchmarkDraws;
+    const auto gpuMs = ComputePercentiles(timings.gpuMs).p50;
+
+    json << "    \"" << Layout::name << "\": {"
+         << "\"stride\": " << Format::stride
+         << ", \"vertex_bytes\": " << Format::stride * scene.mesh.positions.size()
+         << ", \"index_bytes\": " << indexBytes
+         << ", \"mtris_per_s\": " << (gpuMs > 0.0 ? triangles / (gpuMs * 1.0e3) : 0.0)
+         << ", \"error\": " << error
+         << ", \"timings\": " << timings << "}";
+}
+
+} // detail
+
+void RunCompressionBenchmark(Window& window, const Camera& camera,
+                             const BenchmarkSettings& settings)
+{
+    auto mesh = SphereMeshData(settings.count);
+    const auto bounds = ComputeBounds(mesh.positions);
+
+    detail::CompressionScene scene{
+        move(mesh), bounds,
+        UniformBuffer{frameBinding, sizeof(FrameUniforms)},
+        UniformArena{objectBinding, UniformArena::stride(sizeof(ObjectUniforms)) * meshBenchmarkDraws}
+    };
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"compression\",\n"
+         << "  \"vertices\": " << scene.mesh.positions.size() << ",\n"
+         << "  \"triangles\": " << scene.mesh.indices.size() / 3 << ",\n"
+         << "  \"draws\": " << meshBenchmarkDraws << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"layouts\": {\n";
+
+    detail::MeasureLayout<detail::FloatLayout>(json, window, camera, settings, scene);
+    json << ",\n";
+    detail::MeasureLayout<detail::Snorm16Layout>(json, window, camera, settings, scene);
+    json << ",\n";
+    detail::MeasureLayout<detail::HalfLayout>(json, window, camera, settings, scene);
+    json << ",\n";
+    detail::MeasureLayout<detail::OctahedralLayout>(json, window, camera, settings, scene);
+
+    json << "\n  }\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
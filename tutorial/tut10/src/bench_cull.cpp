@@ -0,0 +1,145 @@
+#include "batch_math.h"
+#include "benchmark.h"
+#include "camera.h"
+#include "frustum_cull.h"
+#include "parallel.h"
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+// objects scattered through a cube around a camera at its center looking
+// down +z, about a tenth of them in view
+const float cullWorldSize = 1000.0f;
+
+Camera CullCamera()
+{
+    Camera camera;
+    camera.perspective(glm::radians(60.0f), 16.0f / 9.0f, 1.0f, cullWorldSize * 0.5f);
+    camera.position(glm::vec3{0.0f});
+    camera.target(glm::vec3{0.0f, 0.0f, 1.0f});
+    return camera;
+}
+
+// ns per object, and the visible indices of the last run
+template<typename Bounds, typename Cull>
+Percentiles TimeCull(const BenchmarkSettings& settings, const Bounds& bounds, vector<uint32_t>& visible, Cull cull)
+{
+    vector<double> ns;
+    for (int i = 0; i < settings.warmup + settings.frames; ++i)
+    {
+        Stopwatch timer;
+        cull(bounds, visible);
+        const auto ms = timer.elapsedMs();
+
+        if (i >= settings.warmup)
+            ns.push_back(ms * 1e6 / double(bounds.size()));
+    }
+
+    return ComputePercentiles(ns);
+}
+
+// every kernel on one thread, then the best on every thread; false when
+// any of them disagrees with the glm one
+bool MeasureCull(ostream& json, const BenchmarkSettings& settings, size_t count, const Frustum& frustum)
+{
+    mt19937 random{static_cast<unsigned>(count)};
+    uniform_real_distribution<float> position{-0.5f * cullWorldSize, 0.5f * cullWorldSize};
+    uniform_real_distribution<float> size{0.5f, 5.0f};
+
+    PackedSpheres spheres;
+    PackedBoxes boxes;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const glm::vec3 center{position(random), position(random), position(random)};
+        const auto extent = size(random);
+        spheres.add(center, extent);
+        boxes.add(center - glm::vec3{extent}, center + glm::vec3{extent});
+    }
+
+    const auto best = CurrentMathKernel();
+    const auto threads = HardwareThreads();
+    vector<unsigned> threadCounts{1};
+    if (threads > 1)
+        threadCounts.push_back(threads);
+
+    vector<uint32_t> expectedSpheres, expectedBoxes, visible;
+    auto same = true;
+
+    json << "    {\"objects\": " << count << ", \"kernels\": [";
+
+    auto first = true;
+    for (auto kernel : {MathKernel::glm, MathKernel::sse41, MathKernel::avx2, MathKernel::avx512})
+    {
+        if (!SupportsMathKernel(kernel))
+            continue;
+
+        SetMathKernel(kernel);
+
+        for (auto t : threadCounts)
+        {
+            if (t > 1 && kernel != best)
+                continue;
+
+            const auto spheresNs = TimeCull(settings, spheres, visible, [&](const PackedSpheres& s, vector<uint32_t>& v)
+            {
+                CullSpheres(frustum, s, v, t);
+            });
+            if (kernel == MathKernel::glm)
+                expectedSpheres = visible;
+            same = same && visible == expectedSpheres;
+
+            const auto boxesNs = TimeCull(settings, boxes, visible, [&](const PackedBoxes& b, vector<uint32_t>& v)
+            {
+                CullBoxes(frustum, b, v, t);
+            });
+            if (kernel == MathKernel::glm)
+                expectedBoxes = visible;
+            same = same && visible == expectedBoxes;
+
+            json << (first ? "\n" : ",\n")
+                 << "      {\"kernel\": \"" << kernel << "\", \"threads\": " << t
+                 << ",\n       \"spheres_ns\": " << spheresNs
+                 << ",\n       \"boxes_ns\": " << boxesNs << "}";
+            first = false;
+        }
+    }
+
+    SetMathKernel(best);
+
+    json << "\n     ], \"visible_spheres\": " << expectedSpheres.size()
+         << ", \"visible_boxes\": " << expectedBoxes.size()
+         << ", \"exact\": " << (same ? "true" : "false") << "}";
+
+    return same;
+}
+
+} // detail
+
+void RunCullBenchmark(const BenchmarkSettings& settings)
+{
+    const auto frustum = ExtractFrustum(detail::CullCamera());
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"cull\",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"runs\": [\n";
+
+    auto exact = true;
+    for (size_t count : {size_t{10000}, size_t{100000}, size_t{1000000}})
+    {
+        exact = detail::MeasureCull(json, settings, count, frustum) && exact;
+        json << (count < 1000000 ? ",\n" : "\n");
+    }
+
+    json << "  ]\n}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+
+    if (!exact)
+        throw runtime_error{"A culling kernel disagrees with IntersectsSphere or IntersectsBox"};
+}
@@ -0,0 +1,137 @@
+#include "benchmark.h"
+#include "pipeline.h"
+#include "transform_hierarchy.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+using HierarchyNode = TransformHierarchy::Node;
+
+// a root with 8 children of 8 leaves each, repeated until count nodes;
+// parents gets every node's parent, by handle
+TransformHierarchy BuildBenchmarkHierarchy(size_t count, mt19937& random, vector<HierarchyNode>& parents)
+{
+    uniform_real_distribution<float> offset{-10.0f, 10.0f};
+
+    TransformHierarchy hierarchy;
+    auto next = [&] { return LocalTransform{glm::vec3{offset(random), offset(random), offset(random)},
+                                            offset(random), glm::vec3{0.0f, 1.0f, 0.0f}, glm::vec3{0.5f}}; };
+
+    auto add = [&](HierarchyNode parent)
+    {
+        const auto node = hierarchy.add(next(), parent);
+        parents.resize(max<size_t>(parents.size(), node + 1));
+        parents[node] = parent;
+        return node;
+    };
+
+    while (hierarchy.size() < count)
+    {
+        const auto root = add(HierarchyNode{TransformHierarchy::noParent});
+        for (int c = 0; c < 8 && hierarchy.size() < count; ++c)
+        {
+            const auto child = add(root);
+            for (int l = 0; l < 8 && hierarchy.size() < count; ++l)
+                add(child);
+        }
+    }
+
+    return hierarchy;
+}
+
+// every world matrix from scratch, walking the parents with plain glm
+// multiplies; parents are added before their children, so have lower handles
+vector<glm::mat4> WalkHierarchy(const TransformHierarchy& hierarchy, const vector<HierarchyNode>& parents)
+{
+    vector<glm::mat4> worlds(parents.size());
+
+    for (HierarchyNode node = 0; node < parents.size(); ++node)
+    {
+        const auto local = hierarchy.local(node);
+        const glm::mat4 matrix = Pipeline{}.worldPos(local.position).rotate(local.angle, local.axis).scale(local.scale);
+
+        if (parents[node] == TransformHierarchy::noParent)
+            worlds[node] = matrix;
+        else
+            worlds[node] = worlds[parents[node]] * matrix;
+    }
+
+    return worlds;
+}
+
+} // detail
+
+void RunHierarchyBenchmark(const BenchmarkSettings& settings)
+{
+    mt19937 random{1};
+
+    vector<detail::HierarchyNode> parents;
+    Stopwatch buildTimer;
+    auto hierarchy = detail::BuildBenchmarkHierarchy(settings.count, random, parents);
+    const auto buildMs = buildTimer.elapsedMs();
+    hierarchy.update();
+
+    const auto nodes = static_cast<TransformHierarchy::Node>(hierarchy.size());
+    uniform_int_distribution<TransformHierarchy::Node> pick{0, nodes - 1};
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"hierarchy\",\n"
+         << "  \"nodes\": " << nodes << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"build_ms\": " << buildMs << ",\n"
+         << "  \"changed\": [";
+
+    // each frame moves this share of the nodes, 1 is every frame from scratch
+    const double shares[] = {0.0, 0.001, 0.01, 0.1, 1.0};
+    for (auto share : shares)
+    {
+        const auto changes = static_cast<size_t>(share * nodes);
+
+        vector<double> updateMs;
+        vector<double> recomputed;
+
+        for (int frame = 0; frame < settings.warmup + settings.frames; ++frame)
+        {
+            for (size_t i = 0; i < changes; ++i)
+            {
+                const auto node = share < 1.0 ? pick(random) : static_cast<TransformHierarchy::Node>(i);
+                auto local = hierarchy.local(node);
+                local.angle += 0.01f;
+                hierarchy.setLocal(node, local);
+            }
+
+            Stopwatch timer;
+            const auto updated = hierarchy.update();
+            const auto ms = timer.elapsedMs();
+
+            if (frame >= settings.warmup)
+            {
+                updateMs.push_back(ms);
+                recomputed.push_back(double(updated));
+            }
+        }
+
+        json << (share == shares[0] ? "\n" : ",\n")
+             << "    {\"share\": " << share << ", \"nodes\": " << changes
+             << ",\n     \"update_ms\": " << ComputePercentiles(updateMs)
+             << ",\n     \"recomputed\": " << ComputePercentiles(recomputed) << "}";
+    }
+
+    json << "\n  ]\n}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+
+    // the incremental updates must end where walking the tree from scratch
+    // does
+    const auto expected = detail::WalkHierarchy(hierarchy, parents);
+    for (TransformHierarchy::Node node = 0; node < nodes; ++node)
+        if (memcmp(&expected[node], &hierarchy.world(node), sizeof(glm::mat4)))
+            throw runtime_error{"Incremental world matrices differ from walking the parents"};
+}
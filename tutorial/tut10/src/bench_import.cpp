@@ -0,0 +1,148 @@
+#include "benchmark.h"
+#include "mesh_import.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+// every import runs this many times, the file stays in the page cache
+const int importRuns = 5;
+
+void WriteObj(const string& path, const MeshData& mesh)
+{
+    ofstream file{path};
+    if (!file)
+        throw runtime_error{"Unable to open " + path};
+
+    for (size_t v = 0; v < mesh.positions.size(); ++v)
+    {
+        const auto& p = mesh.positions[v];
+        const auto& c = mesh.colors[v];
+        file << "v " << p.x << ' ' << p.y << ' ' << p.z << ' ' << c.x << ' ' << c.y << ' ' << c.z << '\n';
+    }
+
+    for (const auto& n : mesh.normals)
+        file << "vn " << n.x << ' ' << n.y << ' ' << n.z << '\n';
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        file << "f " << mesh.indices[i] + 1 << "//" << mesh.indices[i] + 1
+             << ' ' << mesh.indices[i + 1] + 1 << "//" << mesh.indices[i + 1] + 1
+             << ' ' << mesh.indices[i + 2] + 1 << "//" << mesh.indices[i + 2] + 1 << '\n';
+}
+
+template<typename T>
+void AppendBytes(string& buffer, const T* data, size_t count)
+{
+    buffer.append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+// one binary buffer: float positions and normals, normalized ubyte colors
+// and uint indices, what exporters commonly write
+void WriteGlb(const string& path, const MeshData& mesh)
+{
+    const auto vertices = mesh.positions.size();
+
+    string binary;
+    AppendBytes(binary, mesh.positions.data(), vertices);
+    AppendBytes(binary, mesh.normals.data(), vertices);
+    for (const auto& c : mesh.colors)
+    {
+        const unsigned char rgba[4] = {
+            static_cast<unsigned char>(c.x * 255.0f + 0.5f), static_cast<unsigned char>(c.y * 255.0f + 0.5f),
+            static_cast<unsigned char>(c.z * 255.0f + 0.5f), static_cast<unsigned char>(c.w * 255.0f + 0.5f)};
+        AppendBytes(binary, rgba, 4);
+    }
+    AppendBytes(binary, mesh.indices.data(), mesh.indices.size());
+
+    const auto vec3Bytes = vertices * sizeof(glm::vec3);
+
+    ostringstream json;
+    json << "{\"asset\": {\"version\": \"2.0\"}, \"scene\": 0, \"scenes\": [{\"nodes\": [0]}],"
+         << " \"nodes\": [{\"mesh\": 0}],"
+         << " \"meshes\": [{\"primitives\": [{\"attributes\": {\"POSITION\": 0, \"NORMAL\": 1, \"COLOR_0\": 2}, \"indices\": 3}]}],"
+         << " \"buffers\": [{\"byteLength\": " << binary.size() << "}],"
+         << " \"bufferViews\": ["
+         << "{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": " << vec3Bytes << "}, "
+         << "{\"buffer\": 0, \"byteOffset\": " << vec3Bytes << ", \"byteLength\": " << vec3Bytes << "}, "
+         << "{\"buffer\": 0, \"byteOffset\": " << vec3Bytes * 2 << ", \"byteLength\": " << vertices * 4 << "}, "
+         << "{\"buffer\": 0, \"byteOffset\": " << vec3Bytes * 2 + vertices * 4 << ", \"byteLength\": " << mesh.indices.size() * 4 << "}],"
+         << " \"accessors\": ["
+         << "{\"bufferView\": 0, \"componentType\": 5126, \"count\": " << vertices << ", \"type\": \"VEC3\"}, "
+         << "{\"bufferView\": 1, \"componentType\": 5126, \"count\": " << vertices << ", \"type\": \"VEC3\"}, "
+         << "{\"bufferView\": 2, \"componentType\": 5121, \"normalized\": true, \"count\": " << vertices << ", \"type\": \"VEC4\"}, "
+         << "{\"bufferView\": 3, \"componentType\": 5125, \"count\": " << mesh.indices.size() << ", \"type\": \"SCALAR\"}]}";
+
+    auto chunk = json.str();
+    chunk.resize((chunk.size() + 3) & ~size_t(3), ' ');
+    binary.resize((binary.size() + 3) & ~size_t(3), '\0');
+
+    const uint32_t header[3] = {0x46546c67, 2, static_cast<uint32_t>(12 + 8 + chunk.size() + 8 + binary.size())};
+    const uint32_t jsonChunk[2] = {static_cast<uint32_t>(chunk.size()), 0x4e4f534a};
+    const uint32_t binChunk[2] = {static_cast<uint32_t>(binary.size()), 0x004e4942};
+
+    ofstream file{path, ios::binary};
+    if (!file)
+        throw runtime_error{"Unable to open " + path};
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(jsonChunk), sizeof(jsonChunk));
+    file << chunk;
+    file.write(reinterpret_cast<const char*>(binChunk), sizeof(binChunk));
+    file << binary;
+}
+
+// the run with the median time
+ImportStats TimeImport(const string& path, unsigned threads)
+{
+    vector<ImportStats> runs(importRuns);
+    for (auto& stats : runs)
+        ImportMesh(path, threads, &stats);
+
+    sort(begin(runs), end(runs), [](const ImportStats& a, const ImportStats& b) { return a.ms < b.ms; });
+    return runs[runs.size() / 2];
+}
+
+void MeasureImport(ostream& json, const string& path, unsigned threads)
+{
+    json << "{\"serial\": " << TimeImport(path, 1)
+         << ", \"parallel\": " << TimeImport(path, threads) << "}";
+}
+
+} // detail
+
+void RunImportBenchmark(const BenchmarkSettings& settings)
+{
+    const string objPath = "bench_import.obj";
+    const string glbPath = "bench_import.glb";
+
+    const auto mesh = SphereMeshData(settings.count);
+
+    detail::WriteObj(objPath, mesh);
+    detail::WriteGlb(glbPath, mesh);
+
+    const auto threads = HardwareThreads();
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"import\",\n"
+         << "  \"vertices\": " << mesh.positions.size() << ",\n"
+         << "  \"triangles\": " << mesh.indices.size() / 3 << ",\n"
+         << "  \"threads\": " << threads << ",\n"
+         << "  \"runs\": " << detail::importRuns << ",\n"
+         << "  \"obj\": ";
+    detail::MeasureImport(json, objPath, threads);
+    json << ",\n  \"glb\": ";
+    detail::MeasureImport(json, glbPath, threads);
+    json << "\n}\n";
+
+    remove(objPath.c_str());
+    remove(glbPath.c_str());
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
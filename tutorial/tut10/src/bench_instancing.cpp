@@ -0,0 +1,91 @@
+#include "benchmark.h"
+#include "instancing.h"
+#include "programs.h"
+#include "uniforms.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+// a cube of small cubes in front of the camera, spinning with the frame
+void GridTransforms(vector<glm::mat4>& transforms, int frame)
+{
+    const auto side = static_cast<size_t>(ceil(cbrt(double(transforms.size()))));
+    const auto spacing = 4.0f / side;
+    const auto angle = frame * 0.01f;
+
+    for (size_t i = 0; i < transforms.size(); ++i)
+    {
+        const glm::vec3 cell{float(i % side), float(i / side % side), float(i / side / side)};
+        const auto position = (cell - glm::vec3{side * 0.5f}) * spacing + glm::vec3{0.0f, 0.0f, 8.0f};
+
+        auto world = glm::translate(glm::mat4(1.0f), position);
+        world = glm::rotate(world, angle, glm::vec3{0.0f, 1.0f, 0.0f});
+        transforms[i] = glm::scale(world, glm::vec3{spacing * 0.3f});
+    }
+}
+
+} // detail
+
+void RunInstancingBenchmark(Window& window, const Camera& camera,
+                            const BenchmarkSettings& settings)
+{
+    auto mesh = CreateTriangleBuffer();
+    auto triangleProg = CreateTriangleGPUProgram();
+    auto instancedProg = CreateInstancedGPUProgram();
+    InstanceBuffer instances{mesh, settings.count};
+
+    UniformBuffer frameUniforms{frameBinding, sizeof(FrameUniforms)};
+    UniformArena objects{objectBinding, UniformArena::stride(sizeof(ObjectUniforms)) * settings.count};
+    vector<GLintptr> offsets(settings.count);
+
+    vector<glm::mat4> transforms(settings.count);
+
+    const auto individual = MeasureFrames(window, settings, [&](int frame)
+    {
+        detail::GridTransforms(transforms, frame);
+        UpdateFrameUniforms(frameUniforms, camera, frame * 0.01f);
+
+        objects.nextFrame();
+        for (size_t i = 0; i < transforms.size(); ++i)
+            offsets[i] = objects.push(ObjectUniforms{transforms[i]});
+
+        triangleProg.enable();
+
+        for (auto offset : offsets)
+        {
+            objects.bind<ObjectUniforms>(offset);
+            DrawMesh(mesh);
+        }
+
+        triangleProg.disable();
+    });
+
+    const auto instanced = MeasureFrames(window, settings, [&](int frame)
+    {
+        detail::GridTransforms(transforms, frame);
+        UpdateFrameUniforms(frameUniforms, camera, frame * 0.01f);
+        instances.update(transforms);
+
+        instancedProg.enable();
+        DrawInstanced(mesh, instances);
+        instancedProg.disable();
+    });
+
+    DestroyTriangleBuffer(mesh);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"instancing\",\n"
+         << "  \"instances\": " << settings.count << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"individual\": " << individual << ",\n"
+         << "  \"instanced\": " << instanced << ",\n"
+         << "  \"uniform_stream\": " << objects.stats() << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
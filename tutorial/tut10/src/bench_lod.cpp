@@ -0,0 +1,125 @@
+#include "benchmark.h"
+#include "camera.h"
+#include "gl_state.h"
+#include "mesh_lod.h"
+#include "programs.h"
+#include "uniforms.h"
+#include "window.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+using LodFormat = VertexFormat<Position3f, Color4u8n, Normal1010102>;
+
+// a field of spheres eight wide going into the distance
+const int lodColumns = 8;
+const int lodRows = 32;
+const int lodObjects = lodColumns * lodRows;
+
+glm::mat4 LodObjectTransform(int object)
+{
+    const glm::vec3 position{(object % lodColumns) * 3.0f - 10.5f, -1.5f, 4.0f + (object / lodColumns) * 6.0f};
+    return glm::translate(glm::mat4(1.0f), position);
+}
+
+// the camera flies down the field and back, so every object crosses every
+// level boundary both ways
+Camera LodCamera(const Camera& camera, int frame)
+{
+    auto moving = camera;
+    moving.position(glm::vec3{0.0f, 0.0f, -1.0f + 90.0f * (0.5f - 0.5f * cos(frame * 0.01f))});
+    return moving;
+}
+
+struct LodRun {
+    FrameTimings timings;
+    vector<double> saved;
+    vector<double> switches;
+};
+
+LodRun DrawLodField(Window& window, const Camera& camera, const BenchmarkSettings& settings,
+                    const LodChain& chain, LitProgram& program, bool lod)
+{
+    UniformBuffer frameUniforms{frameBinding, sizeof(FrameUniforms)};
+    UniformArena objects{objectBinding, UniformArena::stride(sizeof(ObjectUniforms)) * lodObjects};
+
+    auto mesh = CreateMesh<LodFormat>(EncodeVertices<LodFormat>(chain.mesh, IdentityBounds()), chain.mesh.indices);
+    const auto bounds = ComputeBounds(chain.mesh.positions);
+
+    LodSelector selector{static_cast<float>(window.height)};
+    vector<size_t> levels(lodObjects, 0);
+    LodRun run;
+
+    run.timings = MeasureFrames(window, settings, [&](int frame)
+    {
+        const auto moving = LodCamera(camera, frame);
+        UpdateFrameUniforms(frameUniforms, moving, frame * 0.01f);
+        objects.nextFrame();
+        selector.beginFrame(moving);
+
+        program.enable();
+
+        for (int object = 0; object < lodObjects; ++object)
+        {
+            const auto world = LodObjectTransform(object);
+            if (lod)
+                levels[object] = selector.select(chain, bounds, world, levels[object]);
+
+            objects.bind<ObjectUniforms>(objects.push(ObjectUniforms{world}));
+            DrawSubmesh(mesh, chain.levels[levels[object]].submesh);
+        }
+
+        program.disable();
+
+        if (lod && frame >= settings.warmup)
+        {
+            const auto& stats = selector.stats();
+            run.saved.push_back(1.0 - double(stats.drawnTriangles) / stats.fullTriangles);
+            run.switches.push_back(double(stats.switches));
+        }
+    });
+
+    DestroyTriangleBuffer(mesh);
+    return run;
+}
+
+} // detail
+
+void RunLodBenchmark(Window& window, const Camera& camera, const BenchmarkSettings& settings)
+{
+    Stopwatch chainTimer;
+    const auto chain = GenerateLodChain(SphereMeshData(settings.count));
+    const auto chainMs = chainTimer.elapsedMs();
+
+    auto program = CreateLitGPUProgram(NormalEncoding::vector);
+    program.setBounds(IdentityBounds());
+
+    const auto full = detail::DrawLodField(window, camera, settings, chain, program, false);
+    const auto lod = detail::DrawLodField(window, camera, settings, chain, program, true);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"lod\",\n"
+         << "  \"vertices\": " << chain.mesh.positions.size() << ",\n"
+         << "  \"objects\": " << detail::lodObjects << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"chain_ms\": " << chainMs << ",\n"
+         << "  \"levels\": [";
+
+    for (size_t l = 0; l < chain.levels.size(); ++l)
+        json << (l ? ", " : "") << "{\"triangles\": " << chain.levels[l].submesh.indexCount / 3
+             << ", \"error\": " << chain.levels[l].error << "}";
+
+    json << "],\n"
+         << "  \"saved\": " << ComputePercentiles(lod.saved) << ",\n"
+         << "  \"switches\": " << ComputePercentiles(lod.switches) << ",\n"
+         << "  \"full\": " << full.timings << ",\n"
+         << "  \"lod\": " << lod.timings << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
@@ -0,0 +1,159 @@
+#include "batch_math.h"
+#include "benchmark.h"
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+// random floats with a share of signed zeros, so the checks see the sign
+// of a zero sum too
+template<typename T>
+vector<T> RandomMathInput(size_t count, mt19937& random)
+{
+    uniform_real_distribution<float> value{-4.0f, 4.0f};
+    uniform_int_distribution<int> pick{0, 9};
+
+    vector<T> items(count);
+    auto floats = reinterpret_cast<float*>(items.data());
+    for (size_t i = 0; i < count * sizeof(T) / sizeof(float); ++i)
+    {
+        const auto p = pick(random);
+        floats[i] = p == 0 ? 0.0f : p == 1 ? -0.0f : value(random);
+    }
+
+    return items;
+}
+
+template<typename T>
+bool SameBits(const vector<T>& a, const vector<T>& b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+// the same kernels run in place, out being one of the inputs
+template<typename T, typename Run>
+bool SameBitsInPlace(const vector<T>& input, const vector<T>& expected, Run run)
+{
+    auto items = input;
+    run(items.data());
+    return SameBits(items, expected);
+}
+
+// ns per item over the measured runs, run again for the checked result
+template<typename Run>
+Percentiles TimeMathKernel(const BenchmarkSettings& settings, size_t count, Run run)
+{
+    vector<double> ns;
+    for (int i = 0; i < settings.warmup + settings.frames; ++i)
+    {
+        Stopwatch timer;
+        run();
+        const auto ms = timer.elapsedMs();
+
+        if (i >= settings.warmup)
+            ns.push_back(ms * 1e6 / double(count));
+    }
+
+    return ComputePercentiles(ns);
+}
+
+} // detail
+
+void RunMathBenchmark(const BenchmarkSettings& settings)
+{
+    const auto count = settings.count;
+
+    mt19937 random{1};
+    const auto shared = detail::RandomMathInput<glm::mat4>(1, random)[0];
+    const auto left = detail::RandomMathInput<glm::mat4>(count, random);
+    const auto right = detail::RandomMathInput<glm::mat4>(count, random);
+    const auto affineLeft = detail::RandomMathInput<glm::mat4x3>(count, random);
+    const auto affineRight = detail::RandomMathInput<glm::mat4x3>(count, random);
+    const auto points = detail::RandomMathInput<glm::vec3>(count, random);
+
+    vector<glm::mat4> sharedOut(count), sharedExpected(count);
+    vector<glm::mat4> multiplyOut(count), multiplyExpected(count);
+    vector<glm::mat4x3> affineOut(count), affineExpected(count);
+    vector<glm::vec3> pointsOut(count), pointsExpected(count);
+
+    // the reference is plain glm written out here, not any of the kernels
+    for (size_t i = 0; i < count; ++i)
+    {
+        sharedExpected[i] = shared * right[i];
+        multiplyExpected[i] = left[i] * right[i];
+        affineExpected[i] = glm::mat4x3(glm::mat4(affineLeft[i]) * glm::mat4(affineRight[i]));
+        pointsExpected[i] = glm::vec3(shared * glm::vec4(points[i], 1.0f));
+    }
+
+    const auto best = CurrentMathKernel();
+    auto exact = true;
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"math\",\n"
+         << "  \"count\": " << count << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"best\": \"" << best << "\",\n"
+         << "  \"kernels\": [";
+
+    auto first = true;
+    for (auto kernel : {MathKernel::glm, MathKernel::sse41, MathKernel::avx2, MathKernel::avx512})
+    {
+        if (!SupportsMathKernel(kernel))
+            continue;
+
+        SetMathKernel(kernel);
+
+        const auto sharedNs = detail::TimeMathKernel(settings, count, [&]
+        {
+            MultiplyMatrices(shared, right.data(), sharedOut.data(), count);
+        });
+        const auto multiplyNs = detail::TimeMathKernel(settings, count, [&]
+        {
+            MultiplyMatrices(left.data(), right.data(), multiplyOut.data(), count);
+        });
+        const auto affineNs = detail::TimeMathKernel(settings, count, [&]
+        {
+            MultiplyAffine(affineLeft.data(), affineRight.data(), affineOut.data(), count);
+        });
+        const auto pointsNs = detail::TimeMathKernel(settings, count, [&]
+        {
+            TransformPoints(shared, points.data(), pointsOut.data(), count);
+        });
+
+        const auto same = detail::SameBits(sharedOut, sharedExpected) && detail::SameBits(multiplyOut, multiplyExpected) &&
+                          detail::SameBits(affineOut, affineExpected) && detail::SameBits(pointsOut, pointsExpected);
+
+        const auto inPlace =
+            detail::SameBitsInPlace(right, sharedExpected, [&](glm::mat4* m) { MultiplyMatrices(shared, m, m, count); }) &&
+            detail::SameBitsInPlace(left, multiplyExpected, [&](glm::mat4* m) { MultiplyMatrices(m, right.data(), m, count); }) &&
+            detail::SameBitsInPlace(right, multiplyExpected, [&](glm::mat4* m) { MultiplyMatrices(left.data(), m, m, count); }) &&
+            detail::SameBitsInPlace(affineLeft, affineExpected, [&](glm::mat4x3* m) { MultiplyAffine(m, affineRight.data(), m, count); }) &&
+            detail::SameBitsInPlace(affineRight, affineExpected, [&](glm::mat4x3* m) { MultiplyAffine(affineLeft.data(), m, m, count); }) &&
+            detail::SameBitsInPlace(points, pointsExpected, [&](glm::vec3* p) { TransformPoints(shared, p, p, count); });
+
+        exact = exact && same && inPlace;
+
+        json << (first ? "\n" : ",\n")
+             << "    {\"kernel\": \"" << kernel << "\""
+             << ", \"exact\": " << (same ? "true" : "false")
+             << ", \"in_place\": " << (inPlace ? "true" : "false")
+             << ",\n     \"shared_ns\": " << sharedNs
+             << ",\n     \"multiply_ns\": " << multiplyNs
+             << ",\n     \"affine_ns\": " << affineNs
+             << ",\n     \"points_ns\": " << pointsNs << "}";
+        first = false;
+    }
+
+    json << "\n  ]\n}\n";
+
+    SetMathKernel(best);
+    WriteBenchmarkOutput(settings.output, json.str());
+
+    if (!exact)
+        throw runtime_error{"A math kernel doesn't match glm bit for bit"};
+}
@@ -0,0 +1,107 @@
+#include "benchmark.h"
+#include "mesh_file.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+// every load path runs this many times, the file stays in the page cache
+const int meshFileRuns = 20;
+
+// the usual loader: the whole file into a vector, then uploaded from there
+TriangleBuffers ReadMeshFile(const string& path)
+{
+    ifstream file{path, ios::binary};
+    const vector<char> data{istreambuf_iterator<char>{file}, istreambuf_iterator<char>{}};
+
+    ValidateMeshFile(data.data(), data.size(), path);
+
+    MeshFileHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.layout != AssetFormat::layout || header.vertexStride != AssetFormat::stride)
+        throw runtime_error{path + ": not written with AssetFormat"};
+
+    auto mesh = CreateMeshBuffers(data.data() + header.vertexOffset, size_t(header.vertexCount) * header.vertexStride,
+                                  data.data() + header.indexOffset, header.indexCount, header.indexType, header.mode);
+    AssetFormat::setup();
+    return mesh;
+}
+
+TriangleBuffers MapMeshFile(const string& path)
+{
+    MappedMeshFile file{path};
+    return UploadMeshFile<AssetFormat>(file);
+}
+
+TriangleBuffers EncodeMesh(const MeshData& data, const MeshBounds& bounds)
+{
+    return CreateMesh<AssetFormat>(EncodeVertices<AssetFormat>(data, bounds), data.indices);
+}
+
+// load, upload and wait for the GPU copy to be done
+template<typename Load>
+vector<double> TimeLoads(Load load)
+{
+    vector<double> ms;
+
+    for (int run = 0; run < meshFileRuns; ++run)
+    {
+        Stopwatch timer;
+        auto mesh = load();
+        glFinish();
+        ms.push_back(timer.elapsedMs());
+
+        DestroyTriangleBuffer(mesh);
+    }
+
+    return ms;
+}
+
+} // detail
+
+void RunMeshFileBenchmark(const BenchmarkSettings& settings)
+{
+    const string path = "bench_mesh.elm";
+
+    const auto data = SphereMeshData(settings.count);
+    const auto bounds = ComputeBounds(data.positions);
+
+    Stopwatch writeTimer;
+    WriteMeshFile<AssetFormat>(path, data, bounds);
+    const auto writeMs = writeTimer.elapsedMs();
+
+    const auto mapped = detail::TimeLoads([&]() { return detail::MapMeshFile(path); });
+    const auto read = detail::TimeLoads([&]() { return detail::ReadMeshFile(path); });
+    const auto encoded = detail::TimeLoads([&]() { return detail::EncodeMesh(data, bounds); });
+
+    const auto fileBytes = MappedMeshFile{path}.size();
+    remove(path.c_str());
+
+    auto megabytesPerSecond = [&](const vector<double>& ms)
+    {
+        const auto p50 = ComputePercentiles(ms).p50;
+        return p50 > 0.0 ? fileBytes / (p50 * 1.0e3) : 0.0;
+    };
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"meshfile\",\n"
+         << "  \"vertices\": " << data.positions.size() << ",\n"
+         << "  \"triangles\": " << data.indices.size() / 3 << ",\n"
+         << "  \"file_bytes\": " << fileBytes << ",\n"
+         << "  \"runs\": " << detail::meshFileRuns << ",\n"
+         << "  \"write_ms\": " << writeMs << ",\n"
+         << "  \"mmap_ms\": " << ComputePercentiles(mapped) << ",\n"
+         << "  \"mmap_mb_per_s\": " << megabytesPerSecond(mapped) << ",\n"
+         << "  \"read_ms\": " << ComputePercentiles(read) << ",\n"
+         << "  \"read_mb_per_s\": " << megabytesPerSecond(read) << ",\n"
+         << "  \"encode_ms\": " << ComputePercentiles(encoded) << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
@@ -0,0 +1,114 @@
+#include "benchmark.h"
+#include "camera.h"
+#include "gl_state.h"
+#include "meshlet.h"
+#include "mesh_optimizer.h"
+#include "programs.h"
+#include "uniforms.h"
+#include "vertex_compression.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+using MeshletFormat = VertexFormat<Position3f, Color4u8n, Normal1010102>;
+
+// a sphere big and close enough that about half of it is off screen, the
+// other half shows its back to the camera
+glm::mat4 MeshletObjectTransform(int frame)
+{
+    auto world = glm::translate(glm::mat4(1.0f), glm::vec3{2.5f, 0.0f, 6.0f});
+    world = glm::rotate(world, frame * 0.01f, glm::vec3{0.0f, 1.0f, 0.0f});
+    return glm::scale(world, glm::vec3{3.0f});
+}
+
+struct MeshletRun {
+    FrameTimings timings;
+    vector<double> cullMs;
+    vector<double> culled;
+    vector<double> draws;
+};
+
+MeshletRun DrawMeshletSphere(Window& window, const Camera& camera, const BenchmarkSettings& settings,
+                             const MeshData& data, const vector<Meshlet>& meshlets,
+                             LitProgram& program, bool cull)
+{
+    UniformBuffer frameUniforms{frameBinding, sizeof(FrameUniforms)};
+    UniformArena objects{objectBinding, UniformArena::stride(sizeof(ObjectUniforms))};
+
+    auto mesh = CreateMesh<MeshletFormat>(EncodeVertices<MeshletFormat>(data, IdentityBounds()), data.indices);
+    MeshletDrawList list;
+    MeshletRun run;
+
+    run.timings = MeasureFrames(window, settings, [&](int frame)
+    {
+        UpdateFrameUniforms(frameUniforms, camera, frame * 0.01f);
+        objects.nextFrame();
+
+        const auto world = MeshletObjectTransform(frame);
+
+        program.enable();
+        objects.bind<ObjectUniforms>(objects.push(ObjectUniforms{world}));
+
+        if (cull)
+        {
+            Stopwatch cullTimer;
+            const auto stats = CullMeshlets(meshlets, world, static_cast<glm::mat4>(camera), camera.position(),
+                                            mesh.indexType, list);
+            const auto cullMs = cullTimer.elapsedMs();
+
+            DrawMeshlets(mesh, list);
+
+            if (frame >= settings.warmup)
+            {
+                run.cullMs.push_back(cullMs);
+                run.culled.push_back(double(stats.frustumCulled + stats.backfaceCulled) / stats.meshlets);
+                run.draws.push_back(double(stats.draws));
+            }
+        }
+        else
+            DrawMesh(mesh);
+
+        program.disable();
+    });
+
+    DestroyTriangleBuffer(mesh);
+    return run;
+}
+
+} // detail
+
+void RunMeshletBenchmark(Window& window, const Camera& camera, const BenchmarkSettings& settings)
+{
+    auto data = SphereMeshData(settings.count);
+
+    Stopwatch buildTimer;
+    const auto meshlets = BuildMeshlets(data);
+    OptimizeVertexFetch(data);
+    const auto buildMs = buildTimer.elapsedMs();
+
+    auto program = CreateLitGPUProgram(NormalEncoding::vector);
+    program.setBounds(IdentityBounds());
+
+    const auto full = detail::DrawMeshletSphere(window, camera, settings, data, meshlets, program, false);
+    const auto culled = detail::DrawMeshletSphere(window, camera, settings, data, meshlets, program, true);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"meshlet\",\n"
+         << "  \"vertices\": " << data.positions.size() << ",\n"
+         << "  \"triangles\": " << data.indices.size() / 3 << ",\n"
+         << "  \"meshlets\": " << meshlets.size() << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"build_ms\": " << buildMs << ",\n"
+         << "  \"cull_ms\": " << ComputePercentiles(culled.cullMs) << ",\n"
+         << "  \"culled\": " << ComputePercentiles(culled.culled) << ",\n"
+         << "  \"draws\": " << ComputePercentiles(culled.draws) << ",\n"
+         << "  \"full\": " << full.timings << ",\n"
+         << "  \"meshlet\": " << culled.timings << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
@@ -0,0 +1,90 @@
+#include "benchmark.h"
+#include "mesh_optimizer.h"
+#include "programs.h"
+#include "uniforms.h"
+#include "vertex_compression.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+using MeshOptFormat = VertexFormat<Position3f, Color4u8n, Normal1010102>;
+
+// what an exporter that knows nothing about caches hands over: the same
+// triangles in random order
+void ShuffleTriangles(vector<GLuint>& indices)
+{
+    vector<size_t> order(indices.size() / 3);
+    iota(begin(order), end(order), 0);
+    shuffle(begin(order), end(order), mt19937{42});
+
+    vector<GLuint> shuffled;
+    shuffled.reserve(indices.size());
+
+    for (auto t : order)
+        shuffled.insert(end(shuffled), begin(indices) + t * 3, begin(indices) + t * 3 + 3);
+
+    indices = move(shuffled);
+}
+
+FrameTimings DrawMeshData(Window& window, const Camera& camera, const BenchmarkSettings& settings,
+                          const MeshData& data, LitProgram& program)
+{
+    UniformBuffer frameUniforms{frameBinding, sizeof(FrameUniforms)};
+    UniformArena objects{objectBinding, UniformArena::stride(sizeof(ObjectUniforms)) * meshBenchmarkDraws};
+
+    auto mesh = CreateMesh<MeshOptFormat>(EncodeVertices<MeshOptFormat>(data, IdentityBounds()), data.indices);
+
+    const auto timings = MeasureFrames(window, settings, [&](int frame)
+    {
+        UpdateFrameUniforms(frameUniforms, camera, frame * 0.01f);
+        objects.nextFrame();
+
+        program.enable();
+
+        for (int draw = 0; draw < meshBenchmarkDraws; ++draw)
+        {
+            objects.bind<ObjectUniforms>(objects.push(ObjectUniforms{MeshBenchmarkTransform(draw, frame)}));
+            DrawMesh(mesh);
+        }
+
+        program.disable();
+    });
+
+    DestroyTriangleBuffer(mesh);
+    return timings;
+}
+
+} // detail
+
+void RunMeshOptimizerBenchmark(Window& window, const Camera& camera,
+                               const BenchmarkSettings& settings)
+{
+    auto mesh = SphereMeshData(settings.count);
+    detail::ShuffleTriangles(mesh.indices);
+
+    auto program = CreateLitGPUProgram(NormalEncoding::vector);
+    program.setBounds(IdentityBounds());
+
+    const auto shuffled = detail::DrawMeshData(window, camera, settings, mesh, program);
+    const auto report = OptimizeMesh(mesh);
+    const auto optimized = detail::DrawMeshData(window, camera, settings, mesh, program);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"meshopt\",\n"
+         << "  \"vertices\": " << mesh.positions.size() << ",\n"
+         << "  \"triangles\": " << mesh.indices.size() / 3 << ",\n"
+         << "  \"draws\": " << meshBenchmarkDraws << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"optimizer\": " << report << ",\n"
+         << "  \"shuffled\": " << shuffled << ",\n"
+         << "  \"optimized\": " << optimized << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
@@ -0,0 +1,117 @@
+#include "benchmark.h"
+#include "pipeline.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+struct PipelineInput {
+    glm::vec3 scale;
+    glm::vec3 position;
+    float angle;
+    glm::vec3 axis;
+};
+
+vector<PipelineInput> RandomPipelineInputs(size_t count)
+{
+    mt19937 random{1};
+    uniform_real_distribution<float> scale{-2.0f, 2.0f};
+    uniform_real_distribution<float> position{-100.0f, 100.0f};
+    uniform_real_distribution<float> angle{-6.3f, 6.3f};
+    uniform_real_distribution<float> axis{-1.0f, 1.0f};
+
+    vector<PipelineInput> inputs(count);
+    for (auto& input : inputs)
+    {
+        input.scale = glm::vec3{scale(random), scale(random), scale(random)};
+        input.position = glm::vec3{position(random), position(random), position(random)};
+        input.angle = angle(random);
+        input.axis = glm::vec3{axis(random), axis(random), axis(random) + 2.0f};
+    }
+
+    return inputs;
+}
+
+bool SamePipelineTransform(const glm::mat4& a, const glm::mat4& b)
+{
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            if (a[c][r] != b[c][r])
+                return false;
+
+    return true;
+}
+
+template<typename Run>
+Percentiles TimePipeline(const BenchmarkSettings& settings, size_t count, Run run)
+{
+    vector<double> ns;
+    for (int i = 0; i < settings.warmup + settings.frames; ++i)
+    {
+        Stopwatch timer;
+        run();
+        const auto ms = timer.elapsedMs();
+
+        if (i >= settings.warmup)
+            ns.push_back(ms * 1e6 / double(count));
+    }
+
+    return ComputePercentiles(ns);
+}
+
+} // detail
+
+void RunPipelineBenchmark(const BenchmarkSettings& settings)
+{
+    const auto count = settings.count;
+    const auto inputs = detail::RandomPipelineInputs(count);
+
+    vector<glm::mat4> chained(count);
+    vector<glm::mat4> fused(count);
+
+    // what Pipeline did before: glm::scale, glm::translate and glm::rotate
+    // one after the other, each on the matrix the last one returned and
+    // starting from the identity
+    const auto chainedNs = detail::TimePipeline(settings, count, [&]
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& input = inputs[i];
+            auto m = glm::scale(glm::mat4(1.0f), input.scale);
+            m = glm::translate(m, input.position);
+            chained[i] = glm::rotate(m, input.angle, input.axis);
+        }
+    });
+
+    const auto fusedNs = detail::TimePipeline(settings, count, [&]
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& input = inputs[i];
+            fused[i] = Pipeline{}.scale(input.scale).worldPos(input.position).rotate(input.angle, input.axis);
+        }
+    });
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i)
+        mismatches += detail::SamePipelineTransform(chained[i], fused[i]) ? 0 : 1;
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"pipeline\",\n"
+         << "  \"count\": " << count << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"mismatches\": " << mismatches << ",\n"
+         << "  \"chained_ns\": " << chainedNs << ",\n"
+         << "  \"fused_ns\": " << fusedNs << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+
+    if (mismatches)
+        throw runtime_error{"Pipeline doesn't match the chained glm calls"};
+}
@@ -0,0 +1,79 @@
+#include "benchmark.h"
+#include "gl_state.h"
+#include "mesh_strip.h"
+#include "programs.h"
+#include "uniforms.h"
+#include "vertex_compression.h"
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+using StripFormat = VertexFormat<Position3f, Color4u8n, Normal1010102>;
+
+FrameTimings DrawStripMesh(Window& window, const Camera& camera, const BenchmarkSettings& settings,
+                           const MeshData& data, const vector<GLuint>& indices, GLenum mode,
+                           LitProgram& program)
+{
+    UniformBuffer frameUniforms{frameBinding, sizeof(FrameUniforms)};
+    UniformArena objects{objectBinding, UniformArena::stride(sizeof(ObjectUniforms)) * meshBenchmarkDraws};
+
+    auto mesh = CreateMesh<StripFormat>(EncodeVertices<StripFormat>(data, IdentityBounds()), indices, mode);
+
+    const auto timings = MeasureFrames(window, settings, [&](int frame)
+    {
+        UpdateFrameUniforms(frameUniforms, camera, frame * 0.01f);
+        objects.nextFrame();
+
+        program.enable();
+
+        for (int draw = 0; draw < meshBenchmarkDraws; ++draw)
+        {
+            objects.bind<ObjectUniforms>(objects.push(ObjectUniforms{MeshBenchmarkTransform(draw, frame)}));
+            DrawMesh(mesh);
+        }
+
+        program.disable();
+    });
+
+    DestroyTriangleBuffer(mesh);
+    return timings;
+}
+
+} // detail
+
+void RunStripBenchmark(Window& window, const Camera& camera, const BenchmarkSettings& settings)
+{
+    auto mesh = SphereMeshData(settings.count);
+    OptimizeMesh(mesh);
+
+    Stopwatch stripTimer;
+    const auto strips = Stripify(mesh.indices, mesh.positions.size());
+    const auto stripMs = stripTimer.elapsedMs();
+
+    const auto choice = ChoosePrimitives(mesh.indices, mesh.positions.size());
+
+    auto program = CreateLitGPUProgram(NormalEncoding::vector);
+    program.setBounds(IdentityBounds());
+
+    const auto list = detail::DrawStripMesh(window, camera, settings, mesh, mesh.indices, GL_TRIANGLES, program);
+    const auto strip = detail::DrawStripMesh(window, camera, settings, mesh, strips, GL_TRIANGLE_STRIP, program);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"strip\",\n"
+         << "  \"vertices\": " << mesh.positions.size() << ",\n"
+         << "  \"triangles\": " << mesh.indices.size() / 3 << ",\n"
+         << "  \"draws\": " << meshBenchmarkDraws << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"list_indices\": " << mesh.indices.size() << ",\n"
+         << "  \"strip_indices\": " << strips.size() << ",\n"
+         << "  \"stripify_ms\": " << stripMs << ",\n"
+         << "  \"choice\": " << choice << ",\n"
+         << "  \"list\": " << list << ",\n"
+         << "  \"strip\": " << strip << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
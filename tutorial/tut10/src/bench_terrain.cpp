@@ -0,0 +1,93 @@
+#include "benchmark.h"
+#include "camera.h"
+#include "programs.h"
+#include "terrain.h"
+#include "uniforms.h"
+#include "window.h"
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+namespace detail {
+
+const size_t terrainHeightmapSize = 1024;
+
+// a loop over the ground high enough to see to the horizon, looking ahead
+// and a little down; the height swings so the view sweeps from close ground
+// to the whole terrain
+Camera TerrainCamera(const Window& window, const TerrainSettings& settings, int frame)
+{
+    const auto angle = frame * 0.005f;
+    const auto radius = settings.worldSize * 0.3f;
+    const auto height = settings.heightScale * (1.1f + 0.5f * sin(frame * 0.013f));
+
+    Camera camera;
+    camera.perspective(glm::radians(60.0f), float(window.width) / window.height, 1.0f, settings.worldSize * 1.5f);
+    camera.position(glm::vec3{radius * cos(angle), height, radius * sin(angle)});
+    camera.target(glm::vec3{-sin(angle), -0.25f, cos(angle)});
+    return camera;
+}
+
+} // detail
+
+void RunTerrainBenchmark(Window& window, const BenchmarkSettings& settings)
+{
+    Stopwatch buildTimer;
+    const auto heightmap = GenerateHeightmap(detail::terrainHeightmapSize);
+    Terrain terrain{heightmap};
+    const auto buildMs = buildTimer.elapsedMs();
+
+    const auto& terrainSettings = terrain.settings();
+    auto program = CreateTerrainGPUProgram();
+
+    UniformBuffer frameUniforms{frameBinding, sizeof(FrameUniforms)};
+    UniformArena chunks{objectBinding, UniformArena::stride(sizeof(TerrainChunk)) * terrainSettings.maxChunks};
+
+    vector<double> selectMs;
+    vector<double> chunkCounts;
+    vector<double> vertices;
+    vector<double> culled;
+
+    const auto timings = MeasureFrames(window, settings, [&](int frame)
+    {
+        const auto camera = detail::TerrainCamera(window, terrainSettings, frame);
+        UpdateFrameUniforms(frameUniforms, camera, frame * 0.01f);
+        chunks.nextFrame();
+
+        Stopwatch selectTimer;
+        const auto& stats = terrain.select(camera);
+        const auto ms = selectTimer.elapsedMs();
+
+        terrain.draw(program, chunks);
+
+        if (frame >= settings.warmup)
+        {
+            selectMs.push_back(ms);
+            chunkCounts.push_back(double(stats.chunks));
+            vertices.push_back(double(stats.vertices));
+            culled.push_back(double(stats.culled));
+        }
+    });
+
+    const auto gridVertices = size_t(terrainSettings.gridSize + 1) * size_t(terrainSettings.gridSize + 1);
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"benchmark\": \"terrain\",\n"
+         << "  \"heightmap\": " << heightmap.size() << ",\n"
+         << "  \"world_size\": " << terrainSettings.worldSize << ",\n"
+         << "  \"levels\": " << terrainSettings.lodLevels << ",\n"
+         << "  \"max_chunks\": " << terrainSettings.maxChunks << ",\n"
+         << "  \"max_vertices\": " << terrainSettings.maxChunks * gridVertices << ",\n"
+         << "  \"frames\": " << settings.frames << ",\n"
+         << "  \"build_ms\": " << buildMs << ",\n"
+         << "  \"select_ms\": " << ComputePercentiles(selectMs) << ",\n"
+         << "  \"chunks\": " << ComputePercentiles(chunkCounts) << ",\n"
+         << "  \"vertices\": " << ComputePercentiles(vertices) << ",\n"
+         << "  \"culled\": " << ComputePercentiles(culled) << ",\n"
+         << "  \"terrain\": " << timings << "\n"
+         << "}\n";
+
+    WriteBenchmarkOutput(settings.output, json.str());
+}
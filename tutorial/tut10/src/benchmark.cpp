@@ -0,0 +1,160 @@
+#include "benchmark.h"
+#include "profiler.h"
+#include "window.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+double NearestRank(const vector<double>& sorted, double percentile)
+{
+    const auto rank = static_cast<size_t>(ceil(percentile / 100.0 * sorted.size()));
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+string JsonEscape(const string& text)
+{
+    string escaped;
+    escaped.reserve(text.size());
+
+    for (auto c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+} // detail
+
+Percentiles ComputePercentiles(vector<double> samples)
+{
+    if (samples.empty())
+        return Percentiles{0.0, 0.0, 0.0, 0.0};
+
+    sort(begin(samples), end(samples));
+
+    return Percentiles{
+        detail::NearestRank(samples, 50.0),
+        detail::NearestRank(samples, 95.0),
+        detail::NearestRank(samples, 99.0),
+        samples.back()
+    };
+}
+
+ostream& operator << (ostream& out, const Percentiles& p)
+{
+    return out << "{\"p50\": " << p.p50
+               << ", \"p95\": " << p.p95
+               << ", \"p99\": " << p.p99
+               << ", \"max\": " << p.max << "}";
+}
+
+void WriteBenchmarkJson(ostream& out, const BenchmarkReport& report)
+{
+    out << "{\n"
+        << "  \"backend\": \"" << detail::JsonEscape(report.backend) << "\",\n"
+        << "  \"renderer\": \"" << detail::JsonEscape(report.renderer) << "\",\n"
+        << "  \"warmup\": " << report.warmup << ",\n"
+        << "  \"frames\": " << report.frames << ",\n"
+        << "  \"timestep\": " << report.timestep << ",\n"
+        << "  \"cpu_ms\": " << ComputePercentiles(report.cpuMs) << ",\n"
+        << "  \"swap_ms\": " << ComputePercentiles(report.swapMs) << ",\n"
+        << "  \"gpu_ms\": " << ComputePercentiles(report.gpuMs) << ",\n"
+        << "  \"gpu_stalls\": " << report.gpuStalls << ",\n"
+        << "  \"gl_state\": " << report.glState << ",\n"
+        << "  \"gpu_passes\": {";
+
+    auto separator = "\n";
+    for (const auto& pass : report.gpuPassMs)
+    {
+        out << separator << "    \"" << detail::JsonEscape(pass.first) << "\": "
+            << ComputePercentiles(pass.second);
+        separator = ",\n";
+    }
+
+    out << "\n  }\n"
+        << "}" << endl;
+}
+
+void WriteBenchmarkOutput(const string& path, const string& json)
+{
+    if (path.empty())
+    {
+        cout << json << flush;
+        return;
+    }
+
+    ofstream file{path};
+    if (!file)
+        throw runtime_error{"Unable to open " + path};
+
+    file << json;
+}
+
+ostream& operator << (ostream& out, const FrameTimings& timings)
+{
+    return out << "{\"cpu_ms\": " << ComputePercentiles(timings.cpuMs)
+               << ", \"gpu_ms\": " << ComputePercentiles(timings.gpuMs)
+               << ", \"gl_state\": " << timings.glState << "}";
+}
+
+FrameTimings MeasureFrames(Window& window, const BenchmarkSettings& settings,
+                           const function<void(int)>& draw)
+{
+    GpuProfiler profiler;
+    GpuFrameProfile profile;
+    FrameTimings timings;
+
+    auto recordGpu = [&]()
+    {
+        while (profiler.nextResult(profile))
+            if (profile.frame >= size_t(settings.warmup))
+                timings.gpuMs.push_back(profile.totalMs());
+    };
+
+    for (int frame = 0; frame < settings.warmup + settings.frames; ++frame)
+    {
+        if (frame == settings.warmup)
+            GLState::current().resetStats();
+
+        Stopwatch cpuTimer;
+        profiler.beginFrame();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        draw(frame);
+
+        profiler.endFrame();
+        const auto cpuMs = cpuTimer.elapsedMs();
+
+        SwapWindow(window);
+        recordGpu();
+
+        if (frame >= settings.warmup)
+            timings.cpuMs.push_back(cpuMs);
+    }
+
+    timings.glState = GLState::current().stats();
+
+    profiler.flush();
+    recordGpu();
+
+    return timings;
+}
+
+glm::mat4 MeshBenchmarkTransform(int draw, int frame)
+{
+    const glm::vec3 position{(draw % 4) * 1.2f - 1.8f, (draw / 4) * 1.2f - 0.6f, 8.0f};
+
+    auto world = glm::translate(glm::mat4(1.0f), position);
+    world = glm::rotate(world, frame * 0.01f, glm::vec3{0.0f, 1.0f, 0.0f});
+    return glm::scale(world, glm::vec3{0.5f});
+}
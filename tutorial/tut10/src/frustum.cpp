@@ -0,0 +1,52 @@
+#include "frustum.h"
+#include "camera.h"
+
+Frustum ExtractFrustum(const glm::mat4& clip)
+{
+    Frustum frustum;
+
+    // left, right, bottom, top, near, far: row 3 plus or minus row axis
+    for (int axis = 0; axis < 3; ++axis)
+        for (int side = 0; side < 2; ++side)
+        {
+            auto& plane = frustum.planes[axis * 2 + side];
+            for (int column = 0; column < 4; ++column)
+                plane[column] = clip[column][3] + (side ? -clip[column][axis] : clip[column][axis]);
+
+            const auto length = glm::length(glm::vec3{plane.x, plane.y, plane.z});
+            if (length > 0.0f)
+                plane = plane / length;
+        }
+
+    return frustum;
+}
+
+Frustum ExtractFrustum(const Camera& camera)
+{
+    return ExtractFrustum(camera.viewProjection());
+}
+
+bool IntersectsSphere(const Frustum& frustum, const glm::vec3& center, float radius)
+{
+    for (const auto& plane : frustum.planes)
+        if (glm::dot(glm::vec3{plane.x, plane.y, plane.z}, center) + plane.w < -radius)
+            return false;
+
+    return true;
+}
+
+bool IntersectsBox(const Frustum& frustum, const glm::vec3& low, const glm::vec3& high)
+{
+    for (const auto& plane : frustum.planes)
+    {
+        // the corner furthest along the plane normal
+        const glm::vec3 corner{plane.x >= 0.0f ? high.x : low.x,
+                               plane.y >= 0.0f ? high.y : low.y,
+                               plane.z >= 0.0f ? high.z : low.z};
+
+        if (glm::dot(glm::vec3{plane.x, plane.y, plane.z}, corner) + plane.w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
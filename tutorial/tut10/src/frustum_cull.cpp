@@ -0,0 +1,340 @@
+#include "frustum_cull.h"
+#include "batch_math.h"
+#include "parallel.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FRUSTUM_CULL_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+void PackedSpheres::add(const glm::vec3& center, float r)
+{
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(r);
+}
+
+void PackedBoxes::add(const glm::vec3& low, const glm::vec3& high)
+{
+    lowX.push_back(low.x);
+    lowY.push_back(low.y);
+    lowZ.push_back(low.z);
+    highX.push_back(high.x);
+    highY.push_back(high.y);
+    highZ.push_back(high.z);
+}
+
+namespace detail {
+
+// every kernel writes the visible indices of [begin, end) to out and
+// returns how many; the SIMD ones compute the plane distances in the order
+// glm::dot does, so they decide exactly like IntersectsSphere/IntersectsBox
+using SphereCullKernel = size_t (*)(const Frustum& frustum, const PackedSpheres& spheres,
+                                    size_t begin, size_t end, uint32_t* out);
+using BoxCullKernel = size_t (*)(const Frustum& frustum, const PackedBoxes& boxes,
+                                 size_t begin, size_t end, uint32_t* out);
+
+// per plane the box corner furthest along its normal, as arrays
+struct BoxCorners {
+    const float* x[6];
+    const float* y[6];
+    const float* z[6];
+};
+
+BoxCorners FurthestCorners(const Frustum& frustum, const PackedBoxes& boxes)
+{
+    BoxCorners corners;
+    for (int p = 0; p < 6; ++p)
+    {
+        const auto& plane = frustum.planes[p];
+        corners.x[p] = (plane.x >= 0.0f ? boxes.highX : boxes.lowX).data();
+        corners.y[p] = (plane.y >= 0.0f ? boxes.highY : boxes.lowY).data();
+        corners.z[p] = (plane.z >= 0.0f ? boxes.highZ : boxes.lowZ).data();
+    }
+
+    return corners;
+}
+
+size_t CullSpheresGlm(const Frustum& frustum, const PackedSpheres& spheres, size_t begin, size_t end, uint32_t* out)
+{
+    size_t visible = 0;
+    for (auto i = begin; i < end; ++i)
+        if (IntersectsSphere(frustum, glm::vec3{spheres.x[i], spheres.y[i], spheres.z[i]}, spheres.radius[i]))
+            out[visible++] = static_cast<uint32_t>(i);
+
+    return visible;
+}
+
+size_t CullBoxesGlm(const Frustum& frustum, const PackedBoxes& boxes, size_t begin, size_t end, uint32_t* out)
+{
+    size_t visible = 0;
+    for (auto i = begin; i < end; ++i)
+        if (IntersectsBox(frustum, glm::vec3{boxes.lowX[i], boxes.lowY[i], boxes.lowZ[i]},
+                          glm::vec3{boxes.highX[i], boxes.highY[i], boxes.highZ[i]}))
+            out[visible++] = static_cast<uint32_t>(i);
+
+    return visible;
+}
+
+#ifdef FRUSTUM_CULL_X86
+
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+// the lanes not outside any plane, as indices after first
+inline size_t WriteVisible(unsigned visibleBits, size_t first, uint32_t* out)
+{
+    size_t count = 0;
+    for (; visibleBits; visibleBits &= visibleBits - 1)
+        out[count++] = static_cast<uint32_t>(first + __builtin_ctz(visibleBits));
+
+    return count;
+}
+
+SSE41 size_t CullSpheresSse41(const Frustum& frustum, const PackedSpheres& spheres,
+                              size_t begin, size_t end, uint32_t* out)
+{
+    const auto sign = _mm_set1_ps(-0.0f);
+
+    size_t visible = 0;
+    auto i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const auto x = _mm_loadu_ps(&spheres.x[i]);
+        const auto y = _mm_loadu_ps(&spheres.y[i]);
+        const auto z = _mm_loadu_ps(&spheres.z[i]);
+        const auto minusRadius = _mm_xor_ps(_mm_loadu_ps(&spheres.radius[i]), sign);
+
+        auto outside = _mm_setzero_ps();
+        for (const auto& plane : frustum.planes)
+        {
+            const auto d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x),
+                                                            _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+                                                 _mm_mul_ps(_mm_set1_ps(plane.z), z)),
+                                      _mm_set1_ps(plane.w));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, minusRadius));
+        }
+
+        visible += WriteVisible(~_mm_movemask_ps(outside) & 0xf, i, out + visible);
+    }
+
+    return visible + CullSpheresGlm(frustum, spheres, i, end, out + visible);
+}
+
+SSE41 size_t CullBoxesSse41(const Frustum& frustum, const PackedBoxes& boxes,
+                            size_t begin, size_t end, uint32_t* out)
+{
+    const auto corners = FurthestCorners(frustum, boxes);
+    const auto zero = _mm_setzero_ps();
+
+    size_t visible = 0;
+    auto i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        auto outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const auto& plane = frustum.planes[p];
+            const auto d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), _mm_loadu_ps(corners.x[p] + i)),
+                                                            _mm_mul_ps(_mm_set1_ps(plane.y), _mm_loadu_ps(corners.y[p] + i))),
+                                                 _mm_mul_ps(_mm_set1_ps(plane.z), _mm_loadu_ps(corners.z[p] + i))),
+                                      _mm_set1_ps(plane.w));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, zero));
+        }
+
+        visible += WriteVisible(~_mm_movemask_ps(outside) & 0xf, i, out + visible);
+    }
+
+    return visible + CullBoxesGlm(frustum, boxes, i, end, out + visible);
+}
+
+AVX2 size_t CullSpheresAvx2(const Frustum& frustum, const PackedSpheres& spheres,
+                            size_t begin, size_t end, uint32_t* out)
+{
+    const auto sign = _mm256_set1_ps(-0.0f);
+
+    size_t visible = 0;
+    auto i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const auto x = _mm256_loadu_ps(&spheres.x[i]);
+        const auto y = _mm256_loadu_ps(&spheres.y[i]);
+        const auto z = _mm256_loadu_ps(&spheres.z[i]);
+        const auto minusRadius = _mm256_xor_ps(_mm256_loadu_ps(&spheres.radius[i]), sign);
+
+        auto outside = _mm256_setzero_ps();
+        for (const auto& plane : frustum.planes)
+        {
+            const auto d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x),
+                                                                     _mm256_mul_ps(_mm256_set1_ps(plane.y), y)),
+                                                       _mm256_mul_ps(_mm256_set1_ps(plane.z), z)),
+                                         _mm256_set1_ps(plane.w));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, minusRadius, _CMP_LT_OQ));
+        }
+
+        visible += WriteVisible(~_mm256_movemask_ps(outside) & 0xff, i, out + visible);
+    }
+
+    return visible + CullSpheresSse41(frustum, spheres, i, end, out + visible);
+}
+
+AVX2 size_t CullBoxesAvx2(const Frustum& frustum, const PackedBoxes& boxes,
+                          size_t begin, size_t end, uint32_t* out)
+{
+    const auto corners = FurthestCorners(frustum, boxes);
+    const auto zero = _mm256_setzero_ps();
+
+    size_t visible = 0;
+    auto i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        auto outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const auto& plane = frustum.planes[p];
+            const auto d = _mm256_add_ps(
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(corners.x[p] + i)),
+                                            _mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(corners.y[p] + i))),
+                              _mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(corners.z[p] + i))),
+                _mm256_set1_ps(plane.w));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, zero, _CMP_LT_OQ));
+        }
+
+        visible += WriteVisible(~_mm256_movemask_ps(outside) & 0xff, i, out + visible);
+    }
+
+    return visible + CullBoxesSse41(frustum, boxes, i, end, out + visible);
+}
+
+// the visible indices are compressed straight into out
+
+AVX512 size_t CullSpheresAvx512(const Frustum& frustum, const PackedSpheres& spheres,
+                                size_t begin, size_t end, uint32_t* out)
+{
+    const auto lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    size_t visible = 0;
+    auto i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        const auto x = _mm512_loadu_ps(&spheres.x[i]);
+        const auto y = _mm512_loadu_ps(&spheres.y[i]);
+        const auto z = _mm512_loadu_ps(&spheres.z[i]);
+        const auto minusRadius = _mm512_sub_ps(_mm512_setzero_ps(), _mm512_loadu_ps(&spheres.radius[i]));
+
+        __mmask16 inside = 0xffff;
+        for (const auto& plane : frustum.planes)
+        {
+            const auto d = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(plane.x), x),
+                                                                     _mm512_mul_ps(_mm512_set1_ps(plane.y), y)),
+                                                       _mm512_mul_ps(_mm512_set1_ps(plane.z), z)),
+                                         _mm512_set1_ps(plane.w));
+            inside = _mm512_mask_cmp_ps_mask(inside, d, minusRadius, _CMP_NLT_UQ);
+        }
+
+        const auto indices = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), lanes);
+        _mm512_mask_compressstoreu_epi32(out + visible, inside, indices);
+        visible += __builtin_popcount(inside);
+    }
+
+    return visible + CullSpheresAvx2(frustum, spheres, i, end, out + visible);
+}
+
+AVX512 size_t CullBoxesAvx512(const Frustum& frustum, const PackedBoxes& boxes,
+                              size_t begin, size_t end, uint32_t* out)
+{
+    const auto corners = FurthestCorners(frustum, boxes);
+    const auto lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const auto zero = _mm512_setzero_ps();
+
+    size_t visible = 0;
+    auto i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        __mmask16 inside = 0xffff;
+        for (int p = 0; p < 6; ++p)
+        {
+            const auto& plane = frustum.planes[p];
+            const auto d = _mm512_add_ps(
+                _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(plane.x), _mm512_loadu_ps(corners.x[p] + i)),
+                                            _mm512_mul_ps(_mm512_set1_ps(plane.y), _mm512_loadu_ps(corners.y[p] + i))),
+                              _mm512_mul_ps(_mm512_set1_ps(plane.z), _mm512_loadu_ps(corners.z[p] + i))),
+                _mm512_set1_ps(plane.w));
+            inside = _mm512_mask_cmp_ps_mask(inside, d, zero, _CMP_NLT_UQ);
+        }
+
+        const auto indices = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), lanes);
+        _mm512_mask_compressstoreu_epi32(out + visible, inside, indices);
+        visible += __builtin_popcount(inside);
+    }
+
+    return visible + CullBoxesAvx2(frustum, boxes, i, end, out + visible);
+}
+
+#undef SSE41
+#undef AVX2
+#undef AVX512
+
+const SphereCullKernel sphereCullKernels[] = {CullSpheresGlm, CullSpheresSse41, CullSpheresAvx2, CullSpheresAvx512};
+const BoxCullKernel boxCullKernels[] = {CullBoxesGlm, CullBoxesSse41, CullBoxesAvx2, CullBoxesAvx512};
+
+#else
+
+const SphereCullKernel sphereCullKernels[] = {CullSpheresGlm};
+const BoxCullKernel boxCullKernels[] = {CullBoxesGlm};
+
+#endif
+
+// each range writes its visible indices where the range starts, then they
+// are moved down to follow each other
+template<typename Bounds, typename Kernel>
+size_t CullParallel(const Frustum& frustum, const Bounds& bounds, vector<uint32_t>& visible,
+                    unsigned threads, Kernel kernel)
+{
+    const auto count = bounds.size();
+    if (count > numeric_limits<uint32_t>::max())
+        throw length_error{"Too many bounds to cull"};
+
+    visible.resize(count);
+    if (!count)
+        return 0;
+
+    vector<pair<size_t, size_t>> ranges(ParallelWorkers(count, threads));
+
+    ParallelFor(count, threads, [&](size_t begin, size_t end, unsigned worker)
+    {
+        ranges[worker] = make_pair(begin, kernel(frustum, bounds, begin, end, visible.data() + begin));
+    });
+
+    size_t total = 0;
+    for (const auto& range : ranges)
+    {
+        copy_n(begin(visible) + range.first, range.second, begin(visible) + total);
+        total += range.second;
+    }
+
+    visible.resize(total);
+    return total;
+}
+
+} // detail
+
+size_t CullSpheres(const Frustum& frustum, const PackedSpheres& spheres, vector<uint32_t>& visible, unsigned threads)
+{
+    const auto kernel = detail::sphereCullKernels[static_cast<int>(CurrentMathKernel())];
+    return detail::CullParallel(frustum, spheres, visible, threads, kernel);
+}
+
+size_t CullBoxes(const Frustum& frustum, const PackedBoxes& boxes, vector<uint32_t>& visible, unsigned threads)
+{
+    const auto kernel = detail::boxCullKernels[static_cast<int>(CurrentMathKernel())];
+    return detail::CullParallel(frustum, boxes, visible, threads, kernel);
+}
@@ -0,0 +1,196 @@
+#include "gl_state.h"
+#include <algorithm>
+#include <ostream>
+
+using namespace std;
+
+namespace detail {
+
+// no GL object has this name, a binding holding it is unknown
+const GLuint unknownBinding = ~0u;
+
+} // detail
+
+ostream& operator << (ostream& out, const GLStateStats& stats)
+{
+    return out << "{\"issued\": " << stats.issued
+               << ", \"skipped\": " << stats.skipped << "}";
+}
+
+GLState& GLState::current()
+{
+    static GLState state;
+    return state;
+}
+
+GLState::GLState()
+    : m_program{detail::unknownBinding}
+    , m_vao{detail::unknownBinding}
+    , m_stats{0, 0}
+{
+}
+
+bool GLState::update(GLuint& cached, GLuint value)
+{
+    if (cached == value)
+    {
+        ++m_stats.skipped;
+        return false;
+    }
+
+    ++m_stats.issued;
+    cached = value;
+    return true;
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (update(m_program, program))
+        glUseProgram(program);
+}
+
+void GLState::releaseProgram() noexcept
+{
+    ++m_stats.skipped;
+}
+
+void GLState::bindVertexArray(GLuint vao)
+{
+    if (!update(m_vao, vao))
+        return;
+
+    glBindVertexArray(vao);
+
+    // the element array binding belongs to the vertex array
+    cachedBuffer(GL_ELEMENT_ARRAY_BUFFER) = detail::unknownBinding;
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+    if (update(cachedBuffer(target), buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    // a whole buffer binding is tracked as offset 0, size -1
+    bindBufferRange(target, index, buffer, 0, -1);
+}
+
+void GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                              GLintptr offset, GLsizeiptr size)
+{
+    auto it = find_if(begin(m_indexed), end(m_indexed), [&](const IndexedBinding& b)
+    {
+        return b.target == target && b.index == index;
+    });
+
+    if (it != end(m_indexed) && it->buffer == buffer && it->offset == offset && it->size == size)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+
+    ++m_stats.issued;
+
+    if (size < 0)
+        glBindBufferBase(target, index, buffer);
+    else
+        glBindBufferRange(target, index, buffer, offset, size);
+
+    if (it == end(m_indexed))
+        m_indexed.push_back(IndexedBinding{target, index, buffer, offset, size});
+    else
+        *it = IndexedBinding{target, index, buffer, offset, size};
+
+    // the indexed binding calls move the generic binding point as well
+    cachedBuffer(target) = buffer;
+}
+
+void GLState::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLState::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLState::forgetProgram(GLuint program)
+{
+    if (m_program == program)
+        m_program = detail::unknownBinding;
+}
+
+void GLState::forgetVertexArray(GLuint vao)
+{
+    // deleting the bound vertex array reverts the binding to zero
+    if (m_vao == vao)
+    {
+        m_vao = 0;
+        cachedBuffer(GL_ELEMENT_ARRAY_BUFFER) = detail::unknownBinding;
+    }
+}
+
+void GLState::forgetBuffer(GLuint buffer)
+{
+    // GL unbinds a deleted buffer everywhere, and its name can come back
+    for (auto& b : m_buffers)
+        if (b.buffer == buffer)
+            b.buffer = 0;
+
+    m_indexed.erase(remove_if(begin(m_indexed), end(m_indexed), [buffer](const IndexedBinding& b)
+    {
+        return b.buffer == buffer;
+    }), end(m_indexed));
+}
+
+void GLState::invalidate()
+{
+    m_program = detail::unknownBinding;
+    m_vao = detail::unknownBinding;
+    m_buffers.clear();
+    m_indexed.clear();
+    m_capabilities.clear();
+}
+
+GLuint& GLState::cachedBuffer(GLenum target)
+{
+    auto it = find_if(begin(m_buffers), end(m_buffers), [target](const BufferBinding& b)
+    {
+        return b.target == target;
+    });
+
+    if (it != end(m_buffers))
+        return it->buffer;
+
+    m_buffers.push_back(BufferBinding{target, detail::unknownBinding});
+    return m_buffers.back().buffer;
+}
+
+void GLState::setCapability(GLenum capability, bool enabled)
+{
+    auto it = find_if(begin(m_capabilities), end(m_capabilities), [capability](const Capability& c)
+    {
+        return c.capability == capability;
+    });
+
+    if (it != end(m_capabilities) && it->enabled == enabled)
+    {
+        ++m_stats.skipped;
+        return;
+    }
+
+    ++m_stats.issued;
+
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+
+    if (it == end(m_capabilities))
+        m_capabilities.push_back(Capability{capability, enabled});
+    else
+        it->enabled = enabled;
+}
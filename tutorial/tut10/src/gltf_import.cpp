@@ -0,0 +1,706 @@
+#include "mesh_import.h"
+#include "parallel.h"
+#include "stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace detail {
+
+const uint32_t glbMagic = 0x46546c67;     // "glTF"
+const uint32_t glbJsonChunk = 0x4e4f534a; // "JSON"
+const uint32_t glbBinChunk = 0x004e4942;  // "BIN\0"
+
+// just enough JSON for glTF: no \u escapes beyond ASCII, numbers as double
+struct JsonValue {
+    enum class Type { null, boolean, number, string, array, object };
+
+    Type type = Type::null;
+    double value = 0.0;
+    std::string text;
+    vector<JsonValue> items;
+    vector<pair<std::string, JsonValue>> members;
+
+    const JsonValue* find(const std::string& key) const
+    {
+        for (const auto& member : members)
+            if (member.first == key)
+                return &member.second;
+
+        return nullptr;
+    }
+
+    const JsonValue& at(const std::string& key) const
+    {
+        if (auto member = find(key))
+            return *member;
+
+        throw runtime_error{"glTF is missing \"" + key + "\""};
+    }
+
+    const JsonValue& at(size_t index) const
+    {
+        if (type != Type::array || index >= items.size())
+            throw runtime_error{"glTF index out of range"};
+
+        return items[index];
+    }
+
+    double number(const std::string& key, double fallback) const
+    {
+        auto member = find(key);
+        return member ? member->value : fallback;
+    }
+
+    size_t index(const std::string& key) const
+    {
+        return static_cast<size_t>(at(key).value);
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end)
+        : m_p{begin}
+        , m_end{end}
+    {
+    }
+
+    JsonValue parse()
+    {
+        auto value = parseValue(0);
+        skipSpaces();
+        if (m_p != m_end)
+            throw runtime_error{"Trailing data after glTF JSON"};
+
+        return value;
+    }
+
+private:
+    void skipSpaces()
+    {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+            ++m_p;
+    }
+
+    char next()
+    {
+        skipSpaces();
+        if (m_p == m_end)
+            throw runtime_error{"Unexpected end of glTF JSON"};
+
+        return *m_p;
+    }
+
+    void expect(char c)
+    {
+        if (next() != c)
+            throw runtime_error{string{"Expected '"} + c + "' in glTF JSON"};
+
+        ++m_p;
+    }
+
+    void literal(const char* word)
+    {
+        const auto length = strlen(word);
+        if (size_t(m_end - m_p) < length || memcmp(m_p, word, length) != 0)
+            throw runtime_error{"Malformed glTF JSON"};
+
+        m_p += length;
+    }
+
+    std::string parseString()
+    {
+        expect('"');
+
+        std::string text;
+        while (m_p < m_end && *m_p != '"')
+        {
+            if (*m_p == '\\' && ++m_p < m_end)
+            {
+                switch (*m_p)
+                {
+                case 'n': text += '\n'; break;
+                case 't': text += '\t'; break;
+                case 'r': text += '\r'; break;
+                case 'b': text += '\b'; break;
+                case 'f': text += '\f'; break;
+                case 'u':
+                    if (m_end - m_p < 5)
+                        throw runtime_error{"Malformed glTF JSON"};
+                    text += char(strtol(std::string{m_p + 1, m_p + 5}.c_str(), nullptr, 16));
+                    m_p += 4;
+                    break;
+                default: text += *m_p; break;
+                }
+                ++m_p;
+            }
+            else
+                text += *m_p++;
+        }
+
+        expect('"');
+        return text;
+    }
+
+    // depth counts the enclosing objects and arrays, hostile nesting would
+    // otherwise recurse off the end of the stack
+    JsonValue parseValue(int depth)
+    {
+        if (depth > 256)
+            throw runtime_error{"glTF JSON is nested too deeply"};
+
+        JsonValue value;
+
+        switch (next())
+        {
+        case '{':
+            value.type = JsonValue::Type::object;
+            ++m_p;
+            if (next() == '}')
+            {
+                ++m_p;
+                break;
+            }
+            do
+            {
+                auto key = parseString();
+                expect(':');
+                value.members.emplace_back(move(key), parseValue(depth + 1));
+            }
+            while (next() == ',' && ++m_p);
+            expect('}');
+            break;
+
+        case '[':
+            value.type = JsonValue::Type::array;
+            ++m_p;
+            if (next() == ']')
+            {
+                ++m_p;
+                break;
+            }
+            do
+                value.items.push_back(parseValue(depth + 1));
+            while (next() == ',' && ++m_p);
+            expect(']');
+            break;
+
+        case '"':
+            value.type = JsonValue::Type::string;
+            value.text = parseString();
+            break;
+
+        case 't':
+            literal("true");
+            value.type = JsonValue::Type::boolean;
+            value.value = 1.0;
+            break;
+
+        case 'f':
+            literal("false");
+            value.type = JsonValue::Type::boolean;
+            break;
+
+        case 'n':
+            literal("null");
+            break;
+
+        default:
+        {
+            // the document is null terminated, strtod can't run off its end
+            char* end = nullptr;
+            value.type = JsonValue::Type::number;
+            value.value = strtod(m_p, &end);
+            if (end == m_p)
+                throw runtime_error{"Malformed glTF JSON"};
+            m_p = end;
+        }
+        }
+
+        return value;
+    }
+
+private:
+    const char* m_p;
+    const char* m_end;
+};
+
+string ReadGltfFile(const string& path)
+{
+    ifstream file{path, ios::binary};
+    if (!file)
+        throw runtime_error{"Unable to open " + path};
+
+    return string{istreambuf_iterator<char>{file}, istreambuf_iterator<char>{}};
+}
+
+string DecodeBase64(const string& text, size_t begin)
+{
+    auto sextet = [](char c) -> int
+    {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+' || c == '-') return 62;
+        if (c == '/' || c == '_') return 63;
+        return -1;
+    };
+
+    string bytes;
+    bytes.reserve((text.size() - begin) * 3 / 4);
+
+    unsigned bits = 0;
+    int count = 0;
+
+    for (auto i = begin; i < text.size() && text[i] != '='; ++i)
+    {
+        const auto value = sextet(text[i]);
+        if (value < 0)
+            throw runtime_error{"Malformed base64 in glTF buffer"};
+
+        bits = bits << 6 | unsigned(value);
+        count += 6;
+
+        if (count >= 8)
+        {
+            count -= 8;
+            bytes += char(bits >> count & 0xff);
+        }
+    }
+
+    return bytes;
+}
+
+struct GltfDocument {
+    JsonValue json;
+    vector<string> buffers;
+};
+
+GltfDocument LoadGltf(const string& path, size_t& fileBytes)
+{
+    const auto file = ReadGltfFile(path);
+    fileBytes = file.size();
+
+    GltfDocument document;
+    string json = file;
+    string binary;
+    auto hasBinary = false;
+
+    uint32_t magic = 0;
+    if (file.size() >= 12)
+        memcpy(&magic, file.data(), sizeof(magic));
+
+    if (magic == glbMagic)
+    {
+        // 12 byte header, then chunks of (length, type, data) padded to 4
+        json.clear();
+
+        for (size_t offset = 12; offset + 8 <= file.size(); )
+        {
+            uint32_t chunk[2];
+            memcpy(chunk, file.data() + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+
+            if (chunk[0] > file.size() - offset)
+                throw runtime_error{path + " has a truncated chunk"};
+
+            if (chunk[1] == glbJsonChunk)
+                json.assign(file, offset, chunk[0]);
+            else if (chunk[1] == glbBinChunk && !hasBinary)
+            {
+                binary.assign(file, offset, chunk[0]);
+                hasBinary = true;
+            }
+
+            offset += (chunk[0] + 3) & ~3u;
+        }
+    }
+
+    document.json = JsonParser{json.data(), json.data() + json.size()}.parse();
+
+    const auto directory = path.substr(0, path.find_last_of('/') + 1);
+
+    if (auto buffers = document.json.find("buffers"))
+        for (const auto& buffer : buffers->items)
+        {
+            auto uri = buffer.find("uri");
+
+            if (!uri)
+            {
+                if (!hasBinary)
+                    throw runtime_error{path + " has a buffer without data"};
+                document.buffers.push_back(move(binary));
+                hasBinary = false;
+            }
+            else if (uri->text.compare(0, 5, "data:") == 0)
+            {
+                const auto comma = uri->text.find(";base64,");
+                if (comma == string::npos)
+                    throw runtime_error{path + " has a data uri that isn't base64"};
+                document.buffers.push_back(DecodeBase64(uri->text, comma + 8));
+            }
+            else
+                document.buffers.push_back(ReadGltfFile(directory + uri->text));
+
+            if (document.buffers.back().size() < buffer.number("byteLength", 0.0))
+                throw runtime_error{path + " has a buffer shorter than its byteLength"};
+        }
+
+    return document;
+}
+
+size_t GltfComponents(const string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT4") return 16;
+    throw runtime_error{"Unsupported glTF accessor type " + type};
+}
+
+size_t GltfComponentSize(int componentType)
+{
+    switch (componentType)
+    {
+    case 5120: case 5121: return 1;
+    case 5122: case 5123: return 2;
+    case 5125: case 5126: return 4;
+    default: throw runtime_error{"Unsupported glTF component type"};
+    }
+}
+
+// component i of an element, normalized integers are mapped as in the spec
+double GltfComponent(const char* element, size_t i, int componentType, bool normalized)
+{
+    switch (componentType)
+    {
+    case 5120: { int8_t v; memcpy(&v, element + i, 1); return normalized ? max(v / 127.0, -1.0) : v; }
+    case 5121: { uint8_t v; memcpy(&v, element + i, 1); return normalized ? v / 255.0 : v; }
+    case 5122: { int16_t v; memcpy(&v, element + i * 2, 2); return normalized ? max(v / 32767.0, -1.0) : v; }
+    case 5123: { uint16_t v; memcpy(&v, element + i * 2, 2); return normalized ? v / 65535.0 : v; }
+    case 5125: { uint32_t v; memcpy(&v, element + i * 4, 4); return v; }
+    default: { float v; memcpy(&v, element + i * 4, 4); return v; }
+    }
+}
+
+// a count or byte size from the JSON, checked before it becomes a size_t;
+// anything past 2^32 can't index a mesh anyway
+size_t GltfSize(double value)
+{
+    if (!(value >= 0.0 && value <= 4294967295.0) || value != floor(value))
+        throw runtime_error{"Bad glTF count or byte size"};
+
+    return static_cast<size_t>(value);
+}
+
+// an accessor widened to doubles, components per element
+vector<double> ReadGltfAccessor(const GltfDocument& document, size_t index, size_t& components, unsigned threads)
+{
+    const auto& accessor = document.json.at("accessors").at(index);
+    if (accessor.find("sparse"))
+        throw runtime_error{"Sparse glTF accessors are not supported"};
+
+    // without a buffer view the accessor is only the zero base of a sparse one
+    if (!accessor.find("bufferView"))
+        throw runtime_error{"glTF accessors without a buffer view are not supported"};
+
+    const auto count = GltfSize(accessor.at("count").value);
+    const auto componentType = static_cast<int>(accessor.at("componentType").value);
+    const auto normalized = accessor.number("normalized", 0.0) != 0.0;
+    components = GltfComponents(accessor.at("type").text);
+
+    const auto& view = document.json.at("bufferViews").at(accessor.index("bufferView"));
+    const auto& buffer = document.buffers.at(view.index("buffer"));
+
+    // every term is below 2^32, none of the sums below can overflow
+    const auto elementSize = GltfComponentSize(componentType) * components;
+    const auto stride = GltfSize(view.number("byteStride", double(elementSize)));
+    const auto viewOffset = GltfSize(view.number("byteOffset", 0.0));
+    const auto offset = viewOffset + GltfSize(accessor.number("byteOffset", 0.0));
+    const auto viewEnd = viewOffset + GltfSize(view.at("byteLength").value);
+
+    if (stride < elementSize)
+        throw runtime_error{"glTF byte stride is smaller than its elements"};
+
+    if (viewEnd > buffer.size() || offset > viewEnd)
+        throw runtime_error{"glTF accessor reads past its buffer"};
+
+    if (count && ((viewEnd - offset) < elementSize || (viewEnd - offset - elementSize) / stride < count - 1))
+        throw runtime_error{"glTF accessor reads past its buffer"};
+
+    vector<double> values(count * components);
+
+    ParallelFor(count, threads, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto e = begin; e < end; ++e)
+        {
+            const auto element = buffer.data() + offset + e * stride;
+            for (size_t i = 0; i < components; ++i)
+                values[e * components + i] = GltfComponent(element, i, componentType, normalized);
+        }
+    });
+
+    return values;
+}
+
+glm::mat4 GltfNodeTransform(const JsonValue& node)
+{
+    glm::mat4 transform{1.0f};
+
+    if (auto matrix = node.find("matrix"))
+    {
+        for (int i = 0; i < 16; ++i)
+            transform[i / 4][i % 4] = static_cast<float>(matrix->at(i).value);
+
+        return transform;
+    }
+
+    // translation * rotation * scale, the rotation is a unit quaternion x y z w
+    glm::vec3 t{0.0f};
+    glm::vec3 s{1.0f};
+    float q[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+    if (auto translation = node.find("translation"))
+        t = glm::vec3{float(translation->at(0).value), float(translation->at(1).value), float(translation->at(2).value)};
+    if (auto scale = node.find("scale"))
+        s = glm::vec3{float(scale->at(0).value), float(scale->at(1).value), float(scale->at(2).value)};
+    if (auto rotation = node.find("rotation"))
+        for (int i = 0; i < 4; ++i)
+            q[i] = static_cast<float>(rotation->at(i).value);
+
+    const auto x = q[0], y = q[1], z = q[2], w = q[3];
+
+    transform[0] = glm::vec4{1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f} * s.x;
+    transform[1] = glm::vec4{2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f} * s.y;
+    transform[2] = glm::vec4{2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f} * s.z;
+    transform[3] = glm::vec4{t, 1.0f};
+
+    return transform;
+}
+
+// list, strip or fan indices into a triangle list
+vector<GLuint> GltfTriangles(const vector<GLuint>& indices, int mode)
+{
+    if (mode == 4)
+        return indices;
+
+    vector<GLuint> triangles;
+    for (size_t i = 2; i < indices.size(); ++i)
+    {
+        if (mode == 5)
+        {
+            // every other strip triangle is flipped to keep the winding
+            if (i % 2)
+                triangles.insert(end(triangles), {indices[i - 1], indices[i - 2], indices[i]});
+            else
+                triangles.insert(end(triangles), {indices[i - 2], indices[i - 1], indices[i]});
+        }
+        else
+            triangles.insert(end(triangles), {indices[0], indices[i - 1], indices[i]});
+    }
+
+    return triangles;
+}
+
+class GltfFlattener {
+public:
+    GltfFlattener(const GltfDocument& document, unsigned threads)
+        : m_document{document}
+        , m_threads{threads}
+        , m_hasColors{false}
+        , m_hasNormals{false}
+    {
+    }
+
+    void node(size_t index, const glm::mat4& parent, int depth)
+    {
+        // glTF node graphs are trees, this only guards against broken files
+        if (depth > 256)
+            throw runtime_error{"glTF node hierarchy is too deep"};
+
+        const auto& node = m_document.json.at("nodes").at(index);
+        const auto transform = parent * GltfNodeTransform(node);
+
+        if (node.find("mesh"))
+            for (const auto& primitive : m_document.json.at("meshes").at(node.index("mesh")).at("primitives").items)
+                this->primitive(primitive, transform);
+
+        if (auto children = node.find("children"))
+            for (const auto& child : children->items)
+                this->node(static_cast<size_t>(child.value), transform, depth + 1);
+    }
+
+    MeshData finish()
+    {
+        // a primitive without colors turns white once some other primitive
+        // has them, one without normals gets generated ones
+        if (!m_hasColors)
+            m_mesh.colors.clear();
+
+        if (!m_hasNormals)
+            ComputeNormals(m_mesh);
+        else if (!m_withoutNormals.empty())
+        {
+            // primitives never share vertices, normals generated over the
+            // whole mesh are the same as per primitive
+            auto normals = move(m_mesh.normals);
+            ComputeNormals(m_mesh);
+
+            for (const auto& range : m_withoutNormals)
+                copy(begin(m_mesh.normals) + range.first, begin(m_mesh.normals) + range.second, begin(normals) + range.first);
+
+            m_mesh.normals = move(normals);
+        }
+
+        return move(m_mesh);
+    }
+
+private:
+    void primitive(const JsonValue& primitive, const glm::mat4& transform)
+    {
+        const auto mode = static_cast<int>(primitive.number("mode", 4.0));
+        if (mode < 4 || mode > 6)
+            return;
+
+        const auto& attributes = primitive.at("attributes");
+        const auto base = m_mesh.positions.size();
+
+        size_t components;
+        const auto positions = ReadGltfAccessor(m_document, attributes.index("POSITION"), components, m_threads);
+        if (components != 3)
+            throw runtime_error{"glTF POSITION must be VEC3"};
+
+        const auto count = positions.size() / components;
+
+        m_mesh.positions.resize(base + count);
+        m_mesh.colors.resize(base + count, glm::vec4{1.0f});
+        m_mesh.normals.resize(base + count, glm::vec3{0.0f, 0.0f, 1.0f});
+
+        ParallelFor(count, m_threads, [&](size_t begin, size_t end, unsigned)
+        {
+            for (auto v = begin; v < end; ++v)
+            {
+                const auto c = v * components;
+                const glm::vec4 p{float(positions[c]), float(positions[c + 1]), float(positions[c + 2]), 1.0f};
+                const auto world = transform * p;
+                m_mesh.positions[base + v] = glm::vec3{world.x, world.y, world.z};
+            }
+        });
+
+        if (attributes.find("NORMAL"))
+        {
+            m_hasNormals = true;
+            const auto normals = ReadGltfAccessor(m_document, attributes.index("NORMAL"), components, m_threads);
+            if (components != 3)
+                throw runtime_error{"glTF NORMAL must be VEC3"};
+
+            const auto normalMatrix = glm::transpose(glm::inverse(glm::mat3{transform}));
+
+            ParallelFor(count, m_threads, [&](size_t begin, size_t end, unsigned)
+            {
+                for (auto v = begin; v < end && (v + 1) * components <= normals.size(); ++v)
+                {
+                    const auto c = v * components;
+                    const glm::vec3 n{float(normals[c]), float(normals[c + 1]), float(normals[c + 2])};
+                    m_mesh.normals[base + v] = glm::normalize(normalMatrix * n);
+                }
+            });
+        }
+        else
+            m_withoutNormals.emplace_back(base, base + count);
+
+        if (attributes.find("COLOR_0"))
+        {
+            m_hasColors = true;
+            const auto colors = ReadGltfAccessor(m_document, attributes.index("COLOR_0"), components, m_threads);
+            if (components != 3 && components != 4)
+                throw runtime_error{"glTF COLOR_0 must be VEC3 or VEC4"};
+
+            for (size_t v = 0; v < count && (v + 1) * components <= colors.size(); ++v)
+            {
+                auto& color = m_mesh.colors[base + v];
+                color.x = float(colors[v * components]);
+                color.y = float(colors[v * components + 1]);
+                color.z = float(colors[v * components + 2]);
+                color.w = components == 4 ? float(colors[v * components + 3]) : 1.0f;
+            }
+        }
+
+        vector<GLuint> indices;
+        if (primitive.find("indices"))
+        {
+            const auto values = ReadGltfAccessor(m_document, primitive.index("indices"), components, m_threads);
+            indices.reserve(values.size());
+
+            for (auto value : values)
+            {
+                if (value >= count)
+                    throw runtime_error{"glTF index out of range"};
+                indices.push_back(GLuint(value));
+            }
+        }
+        else
+            for (size_t v = 0; v < count; ++v)
+                indices.push_back(GLuint(v));
+
+        for (auto index : GltfTriangles(indices, mode))
+            m_mesh.indices.push_back(GLuint(base + index));
+    }
+
+private:
+    const GltfDocument& m_document;
+    unsigned m_threads;
+    bool m_hasColors;
+    bool m_hasNormals;
+    vector<pair<size_t, size_t>> m_withoutNormals;
+    MeshData m_mesh;
+};
+
+} // detail
+
+MeshData ImportGltf(const string& path, unsigned threads, ImportStats* stats)
+{
+    Stopwatch timer;
+
+    size_t fileBytes;
+    const auto document = detail::LoadGltf(path, fileBytes);
+    detail::GltfFlattener flattener{document, threads};
+
+    if (auto scenes = document.json.find("scenes"))
+    {
+        const auto& scene = scenes->at(static_cast<size_t>(document.json.number("scene", 0.0)));
+        if (auto nodes = scene.find("nodes"))
+            for (const auto& node : nodes->items)
+                flattener.node(static_cast<size_t>(node.value), glm::mat4{1.0f}, 0);
+    }
+    else if (auto nodes = document.json.find("nodes"))
+    {
+        // no scene: every node that isn't somebody's child is a root
+        vector<bool> child(nodes->items.size(), false);
+        for (const auto& node : nodes->items)
+            if (auto children = node.find("children"))
+                for (const auto& index : children->items)
+                    child.at(static_cast<size_t>(index.value)) = true;
+
+        for (size_t node = 0; node < child.size(); ++node)
+            if (!child[node])
+                flattener.node(node, glm::mat4{1.0f}, 0);
+    }
+
+    auto mesh = flattener.finish();
+
+    if (stats)
+        *stats = ImportStats{fileBytes, mesh.positions.size(), mesh.indices.size() / 3,
+                             ParallelWorkers(mesh.positions.size(), threads), timer.elapsedMs()};
+
+    return mesh;
+}
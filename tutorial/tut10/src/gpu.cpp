@@ -1,6 +1,12 @@
 #include "gpu.h"
+#include "program_cache.h"
+#include "gl_state.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <stdexcept>
+#include <utility>
 
 using namespace std;
 
@@ -20,18 +26,10 @@ GLenum toShaderType(ShaderType t)
     return GL_VERTEX_SHADER;
 }
 
-GLuint CreateShader(ShaderType type, const string& source)
-{
-    GLuint shaderObj = glCreateShader(toShaderType(type));
-
-    if (!shaderObj)
-        throw runtime_error{"Unable to create the shader object"};
-
-    const GLchar* sources[1] = { source.c_str() };
-    GLint lengths[1] = {GLint(source.length())};
-    glShaderSource(shaderObj, 1, sources, lengths);
-    glCompileShader(shaderObj);
+bool g_parallelCompile = false;
 
+void CheckShader(GLuint shaderObj)
+{
     GLint buildResult;
     glGetShaderiv(shaderObj, GL_COMPILE_STATUS, &buildResult);
 
@@ -45,11 +43,53 @@ GLuint CreateShader(ShaderType type, const string& source)
 
         throw runtime_error{logMessage};
     }
+}
+
+void CheckProgram(GLuint program)
+{
+    GLint linkResult;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkResult);
+    if (!linkResult)
+    {
+        GLint logLength;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+
+        string logMessage(logLength, ' ');
+        glGetProgramInfoLog(program, logLength, nullptr, &logMessage[0]);
+
+        throw runtime_error{logMessage};
+    }
+}
+
+GLuint CreateShader(ShaderType type, const string& source, CompileMode mode = CompileMode::blocking)
+{
+    GLuint shaderObj = glCreateShader(toShaderType(type));
+
+    if (!shaderObj)
+        throw runtime_error{"Unable to create the shader object"};
+
+    const GLchar* sources[1] = { source.c_str() };
+    GLint lengths[1] = {GLint(source.length())};
+    glShaderSource(shaderObj, 1, sources, lengths);
+    glCompileShader(shaderObj);
+
+    if (mode == CompileMode::blocking)
+    {
+        try
+        {
+            CheckShader(shaderObj);
+        }
+        catch (...)
+        {
+            glDeleteShader(shaderObj);
+            throw;
+        }
+    }
 
     return shaderObj;
 }
 
-GLuint CreateShader(ShaderType type, ifstream& file)
+string ReadSource(ifstream& file)
 {
     if (!file)
         throw invalid_argument{"The specified file doesn't exists"};
@@ -63,18 +103,29 @@ GLuint CreateShader(ShaderType type, ifstream& file)
     source.assign(istreambuf_iterator<char>{file},
                   istreambuf_iterator<char>{ });
 
-    return CreateShader(type, source);
+    return source;
+}
+
+GLuint CreateShader(ShaderType type, ifstream& file)
+{
+    return CreateShader(type, ReadSource(file));
 }
 
 } // detail
 
+ShaderSource LoadShaderSource(ShaderType type, const string& path)
+{
+    ifstream file{path};
+    return ShaderSource{type, detail::ReadSource(file)};
+}
+
 Shader::Shader(ShaderType type, ifstream&& file)
     : m_type{type}, m_shader{detail::CreateShader(type, file)}
 {
 }
 
-Shader::Shader(ShaderType type, const string& file)
-    : m_type{type}, m_shader{detail::CreateShader(type, file)}
+Shader::Shader(ShaderType type, const string& source, CompileMode mode)
+    : m_type{type}, m_shader{detail::CreateShader(type, source, mode)}
 {
 }
 
@@ -99,6 +150,11 @@ Shader::~Shader()
         glDeleteShader(m_shader);
 }
 
+void Shader::check() const
+{
+    detail::CheckShader(m_shader);
+}
+
 Program::Program(vector<Shader>&& shaders)
     : m_program{glCreateProgram()}
     , m_shaders{move(shaders)}
@@ -110,15 +166,59 @@ Program::Program(vector<Shader>&& shaders)
         glAttachShader(m_program, static_cast<GLuint>(s));
 
     link();
-    validate();
+    setup({});
+}
 
-    if (glGetError() != GL_NO_ERROR)
-        throw runtime_error{"Unable to get scale_uniform location"};
+Program::Program(LinkedProgram&& linked)
+    : Program(move(linked), {})
+{
+}
+
+Program::Program(const vector<ShaderSource>& sources, ProgramCache* cache)
+    : Program(sources, cache, {})
+{
+}
+
+Program::Program(LinkedProgram&& linked, initializer_list<UniformBlockBinding> blocks)
+    : m_program{linked.program}
+    , m_shaders{move(linked.shaders)}
+{
+    setup(blocks);
+}
+
+Program::Program(const vector<ShaderSource>& sources, ProgramCache* cache,
+                 initializer_list<UniformBlockBinding> blocks)
+    : m_program{glCreateProgram()}
+{
+    if (!m_program)
+        throw runtime_error{"Unable to create gpu program"};
+
+    const auto key = cache ? cache->key(sources) : string{};
+
+    if (!cache || !cache->load(m_program, key))
+    {
+        for (const auto& s : sources)
+            m_shaders.emplace_back(s.type, s.source);
+
+        for (const auto& s : m_shaders)
+            glAttachShader(m_program, static_cast<GLuint>(s));
+
+        if (cache)
+            glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        link();
+
+        if (cache)
+            cache->store(m_program, key);
+    }
+
+    setup(blocks);
 }
 
 Program::Program(Program&& rhs)
     : m_program(rhs.m_program)
     , m_shaders(move(rhs.m_shaders))
+    , m_resources(move(rhs.m_resources))
 {
     rhs.m_program = 0;
 }
@@ -127,6 +227,7 @@ Program& Program::operator = (Program&& rhs)
 {
     m_program = rhs.m_program;
     m_shaders = move(rhs.m_shaders);
+    m_resources = move(rhs.m_resources);
     rhs.m_program = 0;
     return *this;
 }
@@ -138,35 +239,174 @@ Program::~Program()
         for(const auto& s : m_shaders)
             glDetachShader(m_program, static_cast<GLuint>(s));
 
+        GLState::current().forgetProgram(m_program);
         glDeleteProgram(m_program);
     }
 }
 
 void Program::disable()
 {
-    glUseProgram(0);
+    GLState::current().releaseProgram();
 }
 
 void Program::enable()
 {
-    glUseProgram(m_program);
+    GLState::current().useProgram(m_program);
+}
+
+void Program::bindUniformBlock(const string& name, GLuint binding)
+{
+    const auto index = glGetUniformBlockIndex(m_program, name.c_str());
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(m_program, index, binding);
+}
+
+void Program::bindUniformBlock(NameId name, GLuint binding)
+{
+    const auto index = uniformBlock(name);
+    if (index >= 0)
+        glUniformBlockBinding(m_program, index, binding);
+}
+
+GLint Program::uniform(NameId name) const noexcept
+{
+    return find(ResourceKind::uniform, name);
+}
+
+GLint Program::attribute(NameId name) const noexcept
+{
+    return find(ResourceKind::attribute, name);
+}
+
+GLint Program::uniformBlock(NameId name) const noexcept
+{
+    return find(ResourceKind::block, name);
+}
+
+void Program::setUniform(NameId name, GLint value)
+{
+    glProgramUniform1i(m_program, uniform(name), value);
+}
+
+void Program::setUniform(NameId name, float value)
+{
+    glProgramUniform1f(m_program, uniform(name), value);
+}
+
+void Program::setUniform(NameId name, const glm::vec4& value)
+{
+    glProgramUniform4fv(m_program, uniform(name), 1, glm::value_ptr(value));
+}
+
+void Program::setUniform(NameId name, const glm::mat4& value)
+{
+    glProgramUniformMatrix4fv(m_program, uniform(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+GLint Program::find(ResourceKind kind, NameId name) const noexcept
+{
+    // a handful of entries sorted by kind then hash: a binary search over
+    // plain integers, no strings involved
+    auto it = lower_bound(begin(m_resources), end(m_resources), make_pair(kind, name.hash),
+                          [](const ProgramResource& r, const pair<ResourceKind, uint32_t>& key)
+    {
+        return r.kind < key.first || (r.kind == key.first && r.hash < key.second);
+    });
+
+    if (it == end(m_resources) || it->kind != kind || it->hash != name.hash)
+        return -1;
+
+    return it->location;
+}
+
+void Program::reflect()
+{
+    // names kept until the hashes are known to be unique, for the message
+    vector<pair<ProgramResource, string>> found;
+
+    auto enumerate = [this, &found](GLenum interface, ResourceKind kind)
+    {
+        GLint count = 0;
+        glGetProgramInterfaceiv(m_program, interface, GL_ACTIVE_RESOURCES, &count);
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            const auto isBlock = kind == ResourceKind::block;
+            const GLenum resourceProps[] = {GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX};
+            const GLenum blockProps[] = {GL_NAME_LENGTH, GL_BUFFER_DATA_SIZE};
+
+            GLint values[5] = {0, 0, -1, 1, -1};
+            if (isBlock)
+                glGetProgramResourceiv(m_program, interface, i, 2, blockProps, 2, nullptr, values);
+            else if (kind == ResourceKind::uniform)
+                glGetProgramResourceiv(m_program, interface, i, 5, resourceProps, 5, nullptr, values);
+            else
+                glGetProgramResourceiv(m_program, interface, i, 4, resourceProps, 4, nullptr, values);
+
+            // block members are reached through their block, built-ins have no location
+            if (!isBlock && (values[4] != -1 || values[2] < 0))
+                continue;
+
+            string name(max(values[0], 1), '\0');
+            glGetProgramResourceName(m_program, interface, i, values[0], nullptr, &name[0]);
+            name.resize(name.find('\0'));
+
+            // arrays are reported as "name[0]", look them up as "name"; the
+            // elements of arrays of structs or blocks keep their full name,
+            // "lights[1].color" or "Block[1]"
+            const string arraySuffix = "[0]";
+            if (name.size() > arraySuffix.size() &&
+                name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
+                name.resize(name.size() - arraySuffix.size());
+
+            const auto hash = HashName(name.data(), name.size());
+            if (isBlock)
+                found.emplace_back(ProgramResource{kind, hash, i, 0, values[1]}, move(name));
+            else
+                found.emplace_back(ProgramResource{kind, hash, values[2], GLenum(values[1]), values[3]}, move(name));
+        }
+    };
+
+    enumerate(GL_UNIFORM, ResourceKind::uniform);
+    enumerate(GL_UNIFORM_BLOCK, ResourceKind::block);
+    enumerate(GL_PROGRAM_INPUT, ResourceKind::attribute);
+
+    using Found = pair<ProgramResource, string>;
+    sort(begin(found), end(found), [](const Found& a, const Found& b)
+    {
+        return a.first.kind < b.first.kind || (a.first.kind == b.first.kind && a.first.hash < b.first.hash);
+    });
+
+    auto collision = adjacent_find(begin(found), end(found), [](const Found& a, const Found& b)
+    {
+        return a.first.kind == b.first.kind && a.first.hash == b.first.hash;
+    });
+
+    if (collision != end(found))
+        throw runtime_error{"Program resources \"" + collision->second + "\" and \"" + next(collision)->second +
+                            "\" have the same name id"};
+
+    m_resources.clear();
+    for (auto& f : found)
+        m_resources.push_back(f.first);
 }
 
 void Program::link()
 {
-    GLint linkResult;
     glLinkProgram(m_program);
-    glGetProgramiv(m_program, GL_LINK_STATUS, &linkResult);
-    if (!linkResult)
-    {
-        GLint logLength;
-        glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &logLength);
+    detail::CheckProgram(m_program);
+}
 
-        string logMessage(logLength, ' ');
-        glGetProgramInfoLog(m_program, logLength, nullptr, &logMessage[0]);
+void Program::setup(initializer_list<UniformBlockBinding> blocks)
+{
+    validate();
+    reflect();
 
-        throw runtime_error{logMessage};
-    }
+    for (const auto& block : blocks)
+        bindUniformBlock(block.name, block.binding);
+
+    if (glGetError() != GL_NO_ERROR)
+        throw runtime_error{"Unable to get scale_uniform location"};
 }
 
 void Program::validate()
@@ -184,3 +424,116 @@ void Program::validate()
         throw runtime_error{logMessage};
     }
 }
+
+bool EnableParallelShaderCompile()
+{
+    // let the driver pick the number of compiler threads
+    const GLuint driverChoice = 0xFFFFFFFF;
+
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(driverChoice);
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(driverChoice);
+    else
+        return false;
+
+    detail::g_parallelCompile = true;
+    return true;
+}
+
+PendingProgram::PendingProgram(const vector<ShaderSource>& sources, ProgramCache* cache)
+    : m_program{glCreateProgram()}
+    , m_cache{cache}
+{
+    if (!m_program)
+        throw runtime_error{"Unable to create gpu program"};
+
+    if (m_cache)
+    {
+        m_key = m_cache->key(sources);
+
+        // a restored binary is ready straight away, nothing to store later
+        if (m_cache->load(m_program, m_key))
+        {
+            m_cache = nullptr;
+            return;
+        }
+
+        glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    for (const auto& s : sources)
+        m_shaders.emplace_back(s.type, s.source, CompileMode::deferred);
+
+    for (const auto& s : m_shaders)
+        glAttachShader(m_program, static_cast<GLuint>(s));
+
+    glLinkProgram(m_program);
+}
+
+PendingProgram::PendingProgram(PendingProgram&& rhs)
+    : m_program{rhs.m_program}
+    , m_shaders{move(rhs.m_shaders)}
+    , m_cache{rhs.m_cache}
+    , m_key{move(rhs.m_key)}
+{
+    rhs.m_program = 0;
+}
+
+PendingProgram& PendingProgram::operator = (PendingProgram&& rhs)
+{
+    swap(m_program, rhs.m_program);
+    swap(m_shaders, rhs.m_shaders);
+    m_cache = rhs.m_cache;
+    m_key = move(rhs.m_key);
+    return *this;
+}
+
+PendingProgram::~PendingProgram()
+{
+    if (m_program)
+    {
+        for(const auto& s : m_shaders)
+            glDetachShader(m_program, static_cast<GLuint>(s));
+
+        glDeleteProgram(m_program);
+    }
+}
+
+bool PendingProgram::ready() const
+{
+    if (!m_program)
+        throw logic_error{"PendingProgram already taken"};
+
+    // without the extension we can't ask: report ready and let get() block
+    if (!detail::g_parallelCompile)
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+LinkedProgram PendingProgram::take()
+{
+    if (!m_program)
+        throw logic_error{"PendingProgram already taken"};
+
+    // a link failure is usually caused by a shader: report that log first
+    GLint linkResult = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &linkResult);
+    if (!linkResult)
+    {
+        for (const auto& s : m_shaders)
+            s.check();
+
+        detail::CheckProgram(m_program);
+    }
+
+    if (m_cache)
+        m_cache->store(m_program, m_key);
+
+    LinkedProgram linked{m_program, move(m_shaders)};
+    m_program = 0;
+    return linked;
+}
@@ -0,0 +1,73 @@
+#include "instancing.h"
+#include "gl_state.h"
+#include <stdexcept>
+
+using namespace std;
+
+InstanceBuffer::InstanceBuffer(const TriangleBuffers& mesh, size_t capacity)
+    : m_vbo{0}, m_capacity{capacity}, m_count{0}
+{
+    glGenBuffers(1, &m_vbo);
+    if (!m_vbo)
+        throw runtime_error{"Unable to create Buffer"};
+
+    auto& state = GLState::current();
+
+    state.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_capacity, nullptr, GL_STREAM_DRAW);
+
+    state.bindVertexArray(mesh.vao);
+
+    // a mat4 attribute takes four consecutive locations, one per column
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        const auto location = firstAttribute + column;
+
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(
+                    location, 4, GL_FLOAT, GL_FALSE,
+                    sizeof(glm::mat4), (GLvoid*)(sizeof(glm::vec4) * column)
+                    );
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+InstanceBuffer::InstanceBuffer(InstanceBuffer&& rhs)
+    : m_vbo{rhs.m_vbo}, m_capacity{rhs.m_capacity}, m_count{rhs.m_count}
+{
+    rhs.m_vbo = 0;
+}
+
+InstanceBuffer& InstanceBuffer::operator = (InstanceBuffer&& rhs)
+{
+    swap(m_vbo, rhs.m_vbo);
+    m_capacity = rhs.m_capacity;
+    m_count = rhs.m_count;
+    return *this;
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    if (m_vbo)
+    {
+        GLState::current().forgetBuffer(m_vbo);
+        glDeleteBuffers(1, &m_vbo);
+    }
+}
+
+void InstanceBuffer::update(const vector<glm::mat4>& transforms)
+{
+    if (transforms.size() > m_capacity)
+        throw out_of_range{"Too many instances for the InstanceBuffer"};
+
+    m_count = transforms.size();
+
+    GLState::current().bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * m_count, transforms.data());
+}
+
+void DrawInstanced(const TriangleBuffers& mesh, const InstanceBuffer& instances)
+{
+    DrawMesh(mesh, instances.count());
+}
@@ -1,6 +1,18 @@
 #include "camera.h"
 #include "pipeline.h"
 #include "gpu.h"
+#include "mesh.h"
+#include "programs.h"
+#include "window.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "uniforms.h"
+#include "program_cache.h"
+#include "gl_state.h"
+#include "mesh_file.h"
+#include "mesh_import.h"
+#include "mesh_optimizer.h"
+#include "mesh_strip.h"
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 #include <stdexcept>
@@ -8,6 +20,8 @@
 #include <algorithm>
 #include <array>
 #include <fstream>
+#include <sstream>
+#include <memory>
 
 using namespace std;
 
@@ -15,212 +29,41 @@ float g_xAxis = 1.0f;
 float g_yAxis = 0.0f;
 float g_zAxis = 0.0f;
 
-static int g_triangle_world_uniform_loc;
-
 Camera g_mainCamera;
 
-class TriangleProgram : public Program {
-public:
-    TriangleProgram(std::vector<Shader>&& shaders)
-        : Program{move(shaders)}
-
-    {
-        enable();
-        m_worldUniformLoc = glGetUniformLocation(m_program, "world");
-        disable();
-    }
-
-    TriangleProgram(const Program&) = delete;
-    TriangleProgram(Program&& rhs);
-
-    void setModelViewProjection(const glm::mat4& mvp)
-    {
-        glUniformMatrix4fv(m_worldUniformLoc, 1, GL_FALSE, glm::value_ptr(mvp));
-    }
-
-private:
-    GLuint m_worldUniformLoc;
-};
-
-SDL_Window* InitializeWindow(int width, int height, const std::string& title)
+void InitCamera(const Window& window)
 {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0)
-        throw runtime_error{"Unable to init SDL2"};
-
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
-                        SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
-                        SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-
-    auto window = SDL_CreateWindow(title.c_str(),
-                                   SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                   width,
-                                   height,
-                                   SDL_WINDOW_OPENGL);
-
-    if (!window)
-        throw runtime_error{"Unable to create GLFW Window"};
-
-
-    return window;
-}
-
-void SetViewport(int width, int height)
-{
-    glClearColor(1.0f, 0.0f, 0.0f, 0.0f);
-    glViewport(0, 0, width, height);
-}
-
-void InitGrapics(SDL_Window* window)
-{
-    auto context = SDL_GL_CreateContext(window);
-    if (!context)
-        throw std::runtime_error{"Unable to create gl context"};
-
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK)
-        throw runtime_error{"Unable to init GLEW"};
-
-    int width, height;
-    SDL_GetWindowSize(window, &width, &height);
-    SetViewport(width, height);
-
     const float side = 2.0f;
 //    g_mainCamera.ortho(-side, side, -side, side, -side, side);
-    g_mainCamera.perspective(45.0f, float(width) / (float)height, 0.01f, 1000.0f);
-    glEnable(GL_DEPTH_TEST);
+    g_mainCamera.perspective(45.0f, float(window.width) / (float)window.height, 0.01f, 1000.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
 }
 
-struct TriangleBuffers {
-    GLuint vao;
-    GLuint vbo;
-    GLuint ibo;
-    size_t count;
+struct SceneUniforms {
+    UniformBuffer frame{frameBinding, sizeof(FrameUniforms)};
+    UniformArena objects{objectBinding, UniformArena::stride(sizeof(ObjectUniforms)) * 64};
 };
 
-TriangleBuffers CreateTriangleBuffer()
+void drawTriangle(const TriangleBuffers triangle, TriangleProgram& gpuProg,
+                  UniformArena& objects, float scale)
 {
-    enum {vbo, ibo};
-    array<GLuint, 2> buffers = {0};
-
-    std::vector<glm::vec3> vertexes =
-    {
-        // positions
-
-        // front
-        glm::vec3{-1.0f, -1.0f,  1.0f},
-        glm::vec3{ 1.0f, -1.0f,  1.0f},
-        glm::vec3{ 1.0f,  1.0f,  1.0f},
-        glm::vec3{-1.0f,  1.0f,  1.0f},
-        // back
-        glm::vec3{-1.0f, -1.0f, -1.0f},
-        glm::vec3{ 1.0f, -1.0f, -1.0f},
-        glm::vec3{ 1.0f,  1.0f, -1.0f},
-        glm::vec3{-1.0f,  1.0f, -1.0f},
-
-        // colors
-        glm::vec3{1.0f, 0.0f, 1.0f},
-        glm::vec3{0.0f, 1.0f, 0.0f},
-        glm::vec3{0.0f, 0.0f, 1.0f},
-        glm::vec3{1.0f, 1.0f, 1.0f},
-
-        glm::vec3{1.0f, 1.0f, 1.0f},
-        glm::vec3{0.0f, 0.0f, 1.0f},
-        glm::vec3{0.0f, 1.0f, 0.0f},
-        glm::vec3{1.0f, 0.0f, 1.0f},
-    };
-
-    glGenBuffers(buffers.size(), buffers.data());
-
-    if (any_of(begin(buffers), end(buffers), [](GLuint buff) { return buff == 0; } ))
-        throw runtime_error{"Unable to create Buffer"};
-
-    glBindBuffer(GL_ARRAY_BUFFER, buffers[vbo]);
-    glBufferData(GL_ARRAY_BUFFER,
-                 sizeof(vertexes[0]) * vertexes.size(),
-                 vertexes.data(),
-                 GL_STATIC_DRAW
-                 );
-
-    vector<int> indeces = {
-        // front
-        0, 1, 2, 2, 3, 0,
-        // top
-        1, 5, 6, 6, 2, 1,
-        // back
-        7, 6, 5, 5, 4, 7,
-        // bottom
-        4, 0, 3, 3, 7, 4,
-        // left
-        4, 5, 1, 1, 0, 4,
-        // right
-        3, 2, 6, 6, 7, 3,
-    };
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[ibo]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 sizeof(indeces[0]) * indeces.size(),
-                 indeces.data(),
-                 GL_STATIC_DRAW
-                 );
-
-    GLuint vao;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[ibo]);
-
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, buffers[vbo]);
-
-    glVertexAttribPointer(
-                0, 3, GL_FLOAT, GL_FALSE,
-                0, nullptr
-                );
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(
-                1, 3, GL_FLOAT, GL_FALSE,
-                0, (GLvoid*)(sizeof(glm::vec3) * 8)
-                );
+    const auto scaleFactor = sin(scale * 0.1f);
+    const auto p = Pipeline{}
+        .scale(glm::vec3{scaleFactor, scaleFactor, scaleFactor})
+        .worldPos(glm::vec3{sin(scale), 0.0f, 0.0f})
+        .rotate(scale, glm::vec3(g_xAxis, g_yAxis, g_zAxis));
 
-    return TriangleBuffers{vao, buffers[vbo], buffers[ibo], indeces.size()};
-}
+    objects.nextFrame();
+    const auto offset = objects.push(ObjectUniforms{p});
 
-void drawTriangle(const TriangleBuffers triangle, TriangleProgram& gpuProg)
-{
     gpuProg.enable();
-    static float scale = 0.0f;
-
-    Pipeline p;
-
-    glBindVertexArray(triangle.vao);
-
-    scale += 0.01f;
-    const auto scaleFactor = sin(scale * 0.1f);
-    p.scale(glm::vec3{scaleFactor, scaleFactor, scaleFactor});
-    p.worldPos(glm::vec3{sin(scale), 0.0f, 0.0f});
-    p.rotate(scale, glm::vec3(g_xAxis, g_yAxis, g_zAxis));
-
-    const auto mvp = static_cast<glm::mat4>(g_mainCamera) * static_cast<glm::mat4>(p);
-    gpuProg.setModelViewProjection(mvp);
+    objects.bind<ObjectUniforms>(offset);
 
-    glDrawElements(GL_TRIANGLES, triangle.count, GL_UNSIGNED_INT, nullptr);
+    DrawMesh(triangle);
 
     gpuProg.disable();
 }
 
-TriangleProgram CreateTriangleGPUProgram()
-{
-    vector<Shader> shaders;
-    shaders.emplace_back(ShaderType::vertex  , move(ifstream{"../../resources/tut10/shader.vs"}));
-    shaders.emplace_back(ShaderType::fragment, move(ifstream{"../../resources/tut10/shader.fs"}));
-    return TriangleProgram{move(shaders)};
-}
-
 bool HandleWindowsInput()
 {
     auto mustQuit = false;
@@ -294,33 +137,337 @@ bool HandleWindowsInput()
     return mustQuit;
 }
 
-int main(int, char **)
+struct Options {
+    WindowBackend backend = WindowBackend::sdl;
+    int frames = 0;
+    bool benchmark = false;
+    bool profile = false;
+    string bench;
+    string shaderCache = "shader_cache";
+    size_t count = 10000;
+    int warmup = 100;
+    float timestep = 0.01f;
+    string output;
+    string convertInput;
+    string convertOutput;
+};
+
+// a frame count, which can't be negative
+int ParseFrameCount(const string& option, const string& value)
+{
+    const auto count = stoi(value);
+    if (count < 0)
+        throw invalid_argument{option + " can't be negative: " + value};
+
+    return count;
+}
+
+Options ParseOptions(int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+
+        if (arg == "--headless")
+            options.backend = WindowBackend::headless;
+        else if (arg == "--frames" && i + 1 < argc)
+            options.frames = ParseFrameCount(arg, argv[++i]);
+        else if (arg == "--benchmark")
+            options.benchmark = true;
+        else if (arg == "--profile")
+            options.profile = true;
+        else if (arg == "--bench" && i + 1 < argc)
+            options.bench = argv[++i];
+        else if (arg == "--count" && i + 1 < argc)
+            options.count = stoul(argv[++i]);
+        else if (arg == "--shader-cache" && i + 1 < argc)
+            options.shaderCache = argv[++i];
+        else if (arg == "--no-shader-cache")
+            options.shaderCache.clear();
+        else if (arg == "--warmup" && i + 1 < argc)
+            options.warmup = ParseFrameCount(arg, argv[++i]);
+        else if (arg == "--timestep" && i + 1 < argc)
+            options.timestep = stof(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            options.output = argv[++i];
+        else if (arg == "--convert" && i + 2 < argc)
+        {
+            options.convertInput = argv[++i];
+            options.convertOutput = argv[++i];
+        }
+        else
+            throw invalid_argument{"Unknown option: " + arg};
+    }
+
+    if ((options.benchmark || !options.bench.empty()) && options.frames <= 0)
+        options.frames = 1000;
+
+    // nobody can close a headless window, so it always stops on its own
+    if (options.backend == WindowBackend::headless && options.frames <= 0)
+        options.frames = 100;
+
+    return options;
+}
+
+bool MustQuit(const Window& window, const Options& options, int frame)
+{
+    if (options.frames > 0 && frame >= options.frames)
+        return true;
+
+    return window.backend == WindowBackend::sdl && HandleWindowsInput();
+}
+
+// Runs warmup + frames frames on a fixed timestep, so two runs draw exactly
+// the same sequence, and reports the measured frames only.
+void RunBenchmark(Window& window, const TriangleBuffers& triangle, TriangleProgram& gpuProg,
+                  SceneUniforms& uniforms, const Options& options)
+{
+    SetVSync(window, false);
+
+    BenchmarkReport report;
+    report.backend = window.backend == WindowBackend::headless ? "headless" : "sdl";
+    report.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    report.warmup = options.warmup;
+    report.frames = options.frames;
+    report.timestep = options.timestep;
+
+    GpuProfiler profiler;
+    GpuFrameProfile profile;
+    const auto total = options.warmup + options.frames;
+
+    auto recordGpu = [&]()
+    {
+        while (profiler.nextResult(profile))
+        {
+            if (profile.frame < size_t(options.warmup))
+                continue;
+
+            report.gpuMs.push_back(profile.totalMs());
+            for (size_t i = 1; i < profile.scopes.size(); ++i)
+                report.gpuPassMs[profile.path(i)].push_back(profile.scopes[i].durationMs);
+        }
+    };
+
+    for (int frame = 0; frame < total; ++frame)
+    {
+        if (window.backend == WindowBackend::sdl && HandleWindowsInput())
+            throw runtime_error{"Benchmark interrupted"};
+
+        const auto time = (frame + 1) * options.timestep;
+
+        if (frame == options.warmup)
+            GLState::current().resetStats();
+
+        Stopwatch cpuTimer;
+        profiler.beginFrame();
+
+        UpdateFrameUniforms(uniforms.frame, g_mainCamera, time);
+
+        {
+            GpuScope scope{profiler, "clear"};
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        {
+            GpuScope scope{profiler, "triangle"};
+            drawTriangle(triangle, gpuProg, uniforms.objects, time);
+        }
+
+        profiler.endFrame();
+        const auto cpuMs = cpuTimer.elapsedMs();
+
+        Stopwatch swapTimer;
+        SwapWindow(window);
+        const auto swapMs = swapTimer.elapsedMs();
+
+        recordGpu();
+
+        if (frame >= options.warmup)
+        {
+            report.cpuMs.push_back(cpuMs);
+            report.swapMs.push_back(swapMs);
+        }
+    }
+
+    report.glState = GLState::current().stats();
+
+    profiler.flush();
+    recordGpu();
+    report.gpuStalls = profiler.stalls();
+
+    ostringstream json;
+    WriteBenchmarkJson(json, report);
+    WriteBenchmarkOutput(options.output, json.str());
+}
+
+// OBJ or glTF in, optimized .elm in AssetFormat out
+void ConvertMesh(const Options& options)
+{
+    ImportStats stats;
+    auto mesh = ImportMesh(options.convertInput, 0, &stats);
+    const auto report = OptimizeMesh(mesh);
+
+    auto primitives = ChoosePrimitives(mesh.indices, mesh.positions.size());
+    mesh.indices = move(primitives.indices);
+
+    Stopwatch writeTimer;
+    WriteMeshFile<AssetFormat>(options.convertOutput, mesh, ComputeBounds(mesh.positions), primitives.mode);
+
+    cerr << "Import:       " << stats << '\n'
+         << "Optimizer:    " << report << '\n'
+         << "Primitives:   " << primitives << '\n'
+         << "Write:        " << writeTimer.elapsedMs() << " ms" << endl;
+}
+
+// the benchmarks that need no window, false when options.bench isn't one
+bool RunCpuBenchmark(const Options& options)
+{
+    const BenchmarkSettings settings{options.warmup, options.frames, options.count, options.output};
+
+    if (options.bench == "import")
+        RunImportBenchmark(settings);
+    else if (options.bench == "math")
+        RunMathBenchmark(settings);
+    else if (options.bench == "pipeline")
+        RunPipelineBenchmark(settings);
+    else if (options.bench == "hierarchy")
+        RunHierarchyBenchmark(settings);
+    else if (options.bench == "cull")
+        RunCullBenchmark(settings);
+    else
+        return false;
+
+    return true;
+}
+
+void RunSceneBenchmark(Window& window, const Options& options)
+{
+    SetVSync(window, false);
+
+    const BenchmarkSettings settings{options.warmup, options.frames, options.count, options.output};
+
+    if (options.bench == "instancing")
+        RunInstancingBenchmark(window, g_mainCamera, settings);
+    else if (options.bench == "compression")
+        RunCompressionBenchmark(window, g_mainCamera, settings);
+    else if (options.bench == "meshopt")
+        RunMeshOptimizerBenchmark(window, g_mainCamera, settings);
+    else if (options.bench == "meshfile")
+        RunMeshFileBenchmark(settings);
+    else if (options.bench == "lod")
+        RunLodBenchmark(window, g_mainCamera, settings);
+    else if (options.bench == "meshlet")
+        RunMeshletBenchmark(window, g_mainCamera, settings);
+    else if (options.bench == "strip")
+        RunStripBenchmark(window, g_mainCamera, settings);
+    else if (options.bench == "terrain")
+        RunTerrainBenchmark(window, settings);
+    else
+        throw invalid_argument{"Unknown benchmark: " + options.bench};
+}
+
+int main(int argc, char **argv)
 {
     try
     {
-        auto window = InitializeWindow(800, 600, "Tutorial 10 - Pipleine Triangle - SDL2");
+        const auto options = ParseOptions(argc, argv);
+
+        if (!options.convertInput.empty())
+        {
+            ConvertMesh(options);
+            return EXIT_SUCCESS;
+        }
+
+        if (RunCpuBenchmark(options))
+            return EXIT_SUCCESS;
+
+        auto window = InitializeWindow(800, 600, "Tutorial 10 - Pipleine Triangle - SDL2",
+                                       options.backend);
         InitGrapics(window);
+        InitCamera(window);
 
-        cout << "Vendor:       " << glGetString(GL_VENDOR)   << '\n'
+        // keep stdout clean for the benchmark report
+        auto& info = options.benchmark || !options.bench.empty() ? cerr : cout;
+
+        const auto parallelCompile = EnableParallelShaderCompile();
+
+        info << "Vendor:       " << glGetString(GL_VENDOR)   << '\n'
              << "Version:      " << glGetString(GL_VERSION)  << '\n'
              << "Renderer:     " << glGetString(GL_RENDERER) << '\n'
+             << "Parallel:     " << (parallelCompile ? "yes" : "no") << '\n'
              << endl;
 
-        auto triangle = CreateTriangleBuffer();
-        TriangleProgram gpuProg = move(CreateTriangleGPUProgram());
+        unique_ptr<ProgramCache> programCache;
+        if (!options.shaderCache.empty())
+            programCache.reset(new ProgramCache{options.shaderCache});
 
-        while(!HandleWindowsInput())
+        if (!options.bench.empty())
         {
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            drawTriangle(triangle, gpuProg);
-            SDL_GL_SwapWindow(window);
+            RunSceneBenchmark(window, options);
         }
+        else
+        {
+            auto triangle = CreateTriangleBuffer();
+            Stopwatch programTimer;
+            PendingProgram pendingProg{TriangleGPUProgramSources(), programCache.get()};
 
-        glDeleteBuffers(1, &triangle.ibo);
-        glDeleteBuffers(1, &triangle.vbo);
-        glDeleteVertexArrays(1, &triangle.vao);
+            // keep presenting while the driver compiles on its own threads
+            int waitFrames = 0;
+            for (; !pendingProg.ready(); ++waitFrames)
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                SwapWindow(window);
+            }
+
+            TriangleProgram gpuProg = pendingProg.get<TriangleProgram>();
+
+            info << "Programs:     " << programTimer.elapsedMs() << " ms, "
+                 << waitFrames << " frames while compiling";
+            if (programCache)
+                info << " (cache hits " << programCache->stats().hits
+                     << ", misses " << programCache->stats().misses
+                     << ", rejected " << programCache->stats().rejected << ")";
+            info << '\n' << endl;
+            SceneUniforms uniforms;
+
+            if (options.benchmark)
+            {
+                RunBenchmark(window, triangle, gpuProg, uniforms, options);
+            }
+            else
+            {
+                GpuProfiler profiler;
+                GpuFrameProfile profile;
+
+                for (int frame = 0; !MustQuit(window, options, frame); ++frame)
+                {
+                    if (options.profile)
+                        profiler.beginFrame();
+
+                    const auto time = (frame + 1) * 0.01f;
+                    UpdateFrameUniforms(uniforms.frame, g_mainCamera, time);
+
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    drawTriangle(triangle, gpuProg, uniforms.objects, time);
+
+                    if (options.profile)
+                        profiler.endFrame();
+
+                    SwapWindow(window);
+
+                    // one frame every 100 is plenty to read on a console
+                    while (profiler.nextResult(profile))
+                        if (profile.frame % 100 == 0)
+                            cerr << profile;
+                }
+            }
+
+            DestroyTriangleBuffer(triangle);
+        }
 
-        SDL_DestroyWindow(window);
+        DestroyWindow(window);
         SDL_Quit();
     }
     catch(const exception& exc)
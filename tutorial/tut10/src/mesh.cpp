@@ -0,0 +1,261 @@
+#include "mesh.h"
+#include "gl_state.h"
+#include "mesh_optimizer.h"
+#include "mesh_strip.h"
+#include "vertex_compression.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace detail {
+
+template<typename Index>
+void StoreIndices(const vector<GLuint>& indices, vector<unsigned char>& bytes)
+{
+    bytes.resize(sizeof(Index) * indices.size());
+
+    // ~0u narrows to the all ones value of Index, the restart index
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const auto index = static_cast<Index>(indices[i]);
+        memcpy(bytes.data() + i * sizeof(Index), &index, sizeof(Index));
+    }
+}
+
+void EnablePrimitiveRestart(const TriangleBuffers& mesh)
+{
+    if (mesh.mode != GL_TRIANGLES)
+        GLState::current().enable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+} // detail
+
+IndexData PackIndices(const vector<GLuint>& indices, size_t vertexCount)
+{
+    IndexData data{GL_UNSIGNED_INT, indices.size(), {}};
+
+    for (auto index : indices)
+        if (index != primitiveRestart && index >= vertexCount)
+            throw out_of_range{"Index " + to_string(index) + " past the last vertex"};
+
+    if (vertexCount < numeric_limits<GLushort>::max())
+    {
+        data.type = GL_UNSIGNED_SHORT;
+        detail::StoreIndices<GLushort>(indices, data.bytes);
+    }
+    else if (vertexCount < numeric_limits<GLuint>::max())
+        detail::StoreIndices<GLuint>(indices, data.bytes);
+    else
+        throw out_of_range{"Too many vertices for a 32 bit index buffer"};
+
+    return data;
+}
+
+vector<GLuint> JoinStrips(const vector<vector<GLuint>>& strips)
+{
+    vector<GLuint> indices;
+
+    for (const auto& strip : strips)
+    {
+        if (strip.empty())
+            continue;
+
+        if (!indices.empty())
+            indices.push_back(primitiveRestart);
+
+        indices.insert(end(indices), begin(strip), end(strip));
+    }
+
+    return indices;
+}
+
+size_t IndexSize(GLenum type)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE:
+        return sizeof(GLubyte);
+    case GL_UNSIGNED_SHORT:
+        return sizeof(GLushort);
+    case GL_UNSIGNED_INT:
+        return sizeof(GLuint);
+    }
+
+    throw invalid_argument{"Not an index type"};
+}
+
+TriangleBuffers CreateMeshBuffers(const void* vertexes, size_t size,
+                                  const IndexData& indices, GLenum mode)
+{
+    return CreateMeshBuffers(vertexes, size, indices.bytes.data(), indices.count, indices.type, mode);
+}
+
+TriangleBuffers CreateMeshBuffers(const void* vertexes, size_t vertexBytes,
+                                  const void* indices, size_t indexCount,
+                                  GLenum indexType, GLenum mode)
+{
+    enum {vbo, ibo};
+    array<GLuint, 2> buffers = {0};
+    auto& state = GLState::current();
+
+    glGenBuffers(buffers.size(), buffers.data());
+
+    if (any_of(begin(buffers), end(buffers), [](GLuint buff) { return buff == 0; } ))
+        throw runtime_error{"Unable to create Buffer"};
+
+    // meshes never change once uploaded, immutable storage lets the driver
+    // place them for good; a zero sized store is GL_INVALID_VALUE, so an
+    // empty stream gets none
+    state.bindBuffer(GL_ARRAY_BUFFER, buffers[vbo]);
+    if (vertexBytes)
+        glBufferStorage(GL_ARRAY_BUFFER, vertexBytes, vertexes, 0);
+
+    // bindings are no longer reset after use, the element array binding would
+    // land in whatever vertex array is still bound
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, buffers[ibo]);
+    if (indexCount)
+        glBufferStorage(GL_COPY_WRITE_BUFFER, IndexSize(indexType) * indexCount, indices, 0);
+
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    state.bindVertexArray(vao);
+
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[ibo]);
+    state.bindBuffer(GL_ARRAY_BUFFER, buffers[vbo]);
+
+    return TriangleBuffers{vao, buffers[vbo], buffers[ibo], indexCount, mode, indexType};
+}
+
+void DrawMesh(const TriangleBuffers& mesh)
+{
+    detail::EnablePrimitiveRestart(mesh);
+    GLState::current().bindVertexArray(mesh.vao);
+    glDrawElements(mesh.mode, mesh.count, mesh.indexType, nullptr);
+}
+
+void DrawMesh(const TriangleBuffers& mesh, GLsizei instances)
+{
+    detail::EnablePrimitiveRestart(mesh);
+    GLState::current().bindVertexArray(mesh.vao);
+    glDrawElementsInstanced(mesh.mode, mesh.count, mesh.indexType, nullptr, instances);
+}
+
+void DrawSubmesh(const TriangleBuffers& mesh, const Submesh& submesh)
+{
+    detail::EnablePrimitiveRestart(mesh);
+    GLState::current().bindVertexArray(mesh.vao);
+
+    const auto offset = submesh.firstIndex * IndexSize(mesh.indexType);
+    glDrawElementsBaseVertex(mesh.mode, submesh.indexCount, mesh.indexType,
+                             (GLvoid*)offset, submesh.baseVertex);
+}
+
+TriangleBuffers CreateTriangleBuffer()
+{
+    MeshData cube;
+
+    cube.positions = {
+        // front
+        glm::vec3{-1.0f, -1.0f,  1.0f},
+        glm::vec3{ 1.0f, -1.0f,  1.0f},
+        glm::vec3{ 1.0f,  1.0f,  1.0f},
+        glm::vec3{-1.0f,  1.0f,  1.0f},
+        // back
+        glm::vec3{-1.0f, -1.0f, -1.0f},
+        glm::vec3{ 1.0f, -1.0f, -1.0f},
+        glm::vec3{ 1.0f,  1.0f, -1.0f},
+        glm::vec3{-1.0f,  1.0f, -1.0f},
+    };
+
+    cube.colors = {
+        glm::vec4{1.0f, 0.0f, 1.0f, 1.0f},
+        glm::vec4{0.0f, 1.0f, 0.0f, 1.0f},
+        glm::vec4{0.0f, 0.0f, 1.0f, 1.0f},
+        glm::vec4{1.0f, 1.0f, 1.0f, 1.0f},
+
+        glm::vec4{1.0f, 1.0f, 1.0f, 1.0f},
+        glm::vec4{0.0f, 0.0f, 1.0f, 1.0f},
+        glm::vec4{0.0f, 1.0f, 0.0f, 1.0f},
+        glm::vec4{1.0f, 0.0f, 1.0f, 1.0f},
+    };
+
+    cube.indices = {
+        // front
+        0, 1, 2, 2, 3, 0,
+        // top
+        1, 5, 6, 6, 2, 1,
+        // back
+        7, 6, 5, 5, 4, 7,
+        // bottom
+        4, 0, 3, 3, 7, 4,
+        // left
+        4, 5, 1, 1, 0, 4,
+        // right
+        3, 2, 6, 6, 7, 3,
+    };
+
+    OptimizeMesh(cube);
+    const auto primitives = ChoosePrimitives(cube.indices, cube.positions.size());
+
+    return CreateMesh<CubeFormat>(EncodeVertices<CubeFormat>(cube, IdentityBounds()), primitives.indices,
+                                  primitives.mode);
+}
+
+MeshData SphereMeshData(size_t vertices)
+{
+    const auto rings = max<size_t>(2, static_cast<size_t>(sqrt(vertices / 2.0)));
+    const auto segments = 2 * rings;
+    const auto pi = 3.14159265358979f;
+
+    MeshData mesh;
+
+    for (size_t ring = 0; ring <= rings; ++ring)
+    {
+        const auto theta = pi * ring / rings;
+
+        for (size_t segment = 0; segment <= segments; ++segment)
+        {
+            const auto phi = 2.0f * pi * segment / segments;
+            const glm::vec3 normal{sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)};
+
+            mesh.positions.push_back(normal);
+            mesh.normals.push_back(normal);
+            mesh.colors.push_back(glm::vec4{normal * 0.5f + glm::vec3{0.5f}, 1.0f});
+        }
+    }
+
+    const auto row = static_cast<GLuint>(segments + 1);
+    for (GLuint ring = 0; ring < rings; ++ring)
+    {
+        for (GLuint segment = 0; segment < segments; ++segment)
+        {
+            const auto a = ring * row + segment;
+            const auto b = a + row;
+
+            mesh.indices.insert(end(mesh.indices), {a, a + 1, b, a + 1, b + 1, b});
+        }
+    }
+
+    return mesh;
+}
+
+void DestroyTriangleBuffer(TriangleBuffers& buffers)
+{
+    auto& state = GLState::current();
+    state.forgetVertexArray(buffers.vao);
+    state.forgetBuffer(buffers.vbo);
+    state.forgetBuffer(buffers.ibo);
+
+    glDeleteBuffers(1, &buffers.ibo);
+    glDeleteBuffers(1, &buffers.vbo);
+    glDeleteVertexArrays(1, &buffers.vao);
+    buffers = TriangleBuffers{0, 0, 0, 0, GL_TRIANGLES, GL_UNSIGNED_INT};
+}
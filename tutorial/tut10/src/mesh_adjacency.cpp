@@ -0,0 +1,34 @@
+#include "mesh_adjacency.h"
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+TriangleAdjacency BuildTriangleAdjacency(const vector<GLuint>& indices, size_t vertexCount)
+{
+    TriangleAdjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+
+    for (auto index : indices)
+        ++adjacency.offsets[index + 1];
+
+    partial_sum(begin(adjacency.offsets), end(adjacency.offsets), begin(adjacency.offsets));
+
+    auto fill = adjacency.offsets;
+    adjacency.triangles.resize(indices.size());
+
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency.triangles[fill[indices[i]]++] = i / 3;
+
+    return adjacency;
+}
+
+void CheckTriangleList(const vector<GLuint>& indices, size_t vertexCount)
+{
+    if (indices.size() % 3)
+        throw invalid_argument{"Not a triangle list"};
+
+    for (auto index : indices)
+        if (index >= vertexCount)
+            throw out_of_range{"Index past the last vertex"};
+}
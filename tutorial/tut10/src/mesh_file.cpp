@@ -0,0 +1,208 @@
+#include "mesh_file.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace detail {
+
+static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader is part of the file format");
+static_assert(sizeof(MeshFileSubmesh) == 12, "MeshFileSubmesh is part of the file format");
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void WritePadding(ofstream& file, uint64_t offset)
+{
+    static const char zeros[meshFileAlignment] = {0};
+    const auto position = static_cast<uint64_t>(file.tellp());
+
+    if (offset > position)
+        file.write(zeros, offset - position);
+}
+
+} // detail
+
+void WriteMeshFile(const string& path, uint64_t layout, uint32_t stride,
+                   const void* vertexes, size_t vertexCount, const IndexData& indices,
+                   GLenum mode, const vector<Submesh>& submeshes, const MeshBounds& bounds)
+{
+    const auto vertexBytes = uint64_t(vertexCount) * stride;
+    const auto tableEnd = sizeof(MeshFileHeader) + submeshes.size() * sizeof(MeshFileSubmesh);
+
+    MeshFileHeader header;
+    header.magic = meshFileMagic;
+    header.version = meshFileVersion;
+    header.layout = layout;
+    header.vertexStride = stride;
+    header.vertexCount = static_cast<uint32_t>(vertexCount);
+    header.indexType = indices.type;
+    header.indexCount = static_cast<uint32_t>(indices.count);
+    header.mode = mode;
+    header.submeshCount = static_cast<uint32_t>(submeshes.size());
+    header.vertexOffset = detail::AlignUp(tableEnd, meshFileAlignment);
+    header.indexOffset = detail::AlignUp(header.vertexOffset + vertexBytes, meshFileAlignment);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        header.boundsCenter[i] = bounds.center[i];
+        header.boundsExtent[i] = bounds.extent[i];
+    }
+
+    const auto temporary = path + ".tmp";
+    {
+        ofstream file{temporary, ios::binary | ios::trunc};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(MeshFileSubmesh));
+
+        detail::WritePadding(file, header.vertexOffset);
+        file.write(static_cast<const char*>(vertexes), vertexBytes);
+
+        detail::WritePadding(file, header.indexOffset);
+        file.write(reinterpret_cast<const char*>(indices.bytes.data()), indices.bytes.size());
+
+        if (!file)
+            throw runtime_error{"Unable to write " + temporary};
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+        throw runtime_error{"Unable to write " + path};
+}
+
+MappedMeshFile::MappedMeshFile(const string& path)
+    : m_data{nullptr}, m_size{0}
+{
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error{"Unable to open " + path};
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(MeshFileHeader)))
+    {
+        close(fd);
+        throw runtime_error{path + " is not a mesh file"};
+    }
+
+    m_size = static_cast<size_t>(info.st_size);
+    auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        throw runtime_error{"Unable to map " + path};
+
+    // the whole file is about to be read front to back by the upload
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    madvise(data, m_size, MADV_WILLNEED);
+    m_data = static_cast<const unsigned char*>(data);
+
+    try
+    {
+        validate(path);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+}
+
+MappedMeshFile::MappedMeshFile(MappedMeshFile&& rhs)
+    : m_data{rhs.m_data}, m_size{rhs.m_size}
+{
+    rhs.m_data = nullptr;
+    rhs.m_size = 0;
+}
+
+MappedMeshFile& MappedMeshFile::operator = (MappedMeshFile&& rhs)
+{
+    if (this != &rhs)
+    {
+        release();
+
+        m_data = rhs.m_data;
+        m_size = rhs.m_size;
+        rhs.m_data = nullptr;
+        rhs.m_size = 0;
+    }
+
+    return *this;
+}
+
+MappedMeshFile::~MappedMeshFile()
+{
+    release();
+}
+
+MeshBounds MappedMeshFile::bounds() const noexcept
+{
+    const auto& h = header();
+    return MeshBounds{
+        glm::vec3{h.boundsCenter[0], h.boundsCenter[1], h.boundsCenter[2]},
+        glm::vec3{h.boundsExtent[0], h.boundsExtent[1], h.boundsExtent[2]}
+    };
+}
+
+void MappedMeshFile::release() noexcept
+{
+    if (m_data)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedMeshFile::validate(const string& path) const
+{
+    ValidateMeshFile(m_data, m_size, path);
+}
+
+void ValidateMeshFile(const void* data, size_t size, const string& path)
+{
+    const auto bytes = static_cast<const unsigned char*>(data);
+
+    MeshFileHeader h;
+    if (size < sizeof(h))
+        throw runtime_error{path + " is not a mesh file"};
+
+    memcpy(&h, bytes, sizeof(h));
+
+    if (h.magic != meshFileMagic)
+        throw runtime_error{path + " is not a mesh file"};
+
+    if (h.version != meshFileVersion)
+        throw runtime_error{path + ": unsupported mesh file version " + to_string(h.version)};
+
+    if (h.indexType != GL_UNSIGNED_SHORT && h.indexType != GL_UNSIGNED_INT)
+        throw runtime_error{path + ": bad index type"};
+
+    if (h.mode != GL_TRIANGLES && h.mode != GL_TRIANGLE_STRIP)
+        throw runtime_error{path + ": bad primitive mode"};
+
+    // the offsets could wrap if added to, so they are checked against the
+    // file size first and the stream sizes against the room after them
+    const auto tableEnd = sizeof(MeshFileHeader) + uint64_t(h.submeshCount) * sizeof(MeshFileSubmesh);
+    const auto vertexBytes = uint64_t(h.vertexCount) * h.vertexStride;
+    const auto indexBytes = uint64_t(h.indexCount) * IndexSize(h.indexType);
+
+    if (h.vertexOffset > size || h.indexOffset > size || h.vertexOffset > h.indexOffset ||
+        h.vertexOffset % meshFileAlignment || h.indexOffset % meshFileAlignment ||
+        tableEnd > h.vertexOffset || vertexBytes > h.indexOffset - h.vertexOffset ||
+        indexBytes > size - h.indexOffset)
+        throw runtime_error{path + ": truncated or corrupt mesh file"};
+
+    for (uint32_t i = 0; i < h.submeshCount; ++i)
+    {
+        MeshFileSubmesh s;
+        memcpy(&s, bytes + sizeof(h) + i * sizeof(s), sizeof(s));
+
+        if (uint64_t(s.firstIndex) + s.indexCount > h.indexCount || s.baseVertex >= max(h.vertexCount, 1u))
+            throw runtime_error{path + ": submesh " + to_string(i) + " out of range"};
+    }
+}
@@ -0,0 +1,442 @@
+#include "mesh_import.h"
+#include "parallel.h"
+#include "stopwatch.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace std;
+
+namespace detail {
+
+const int64_t objMissing = numeric_limits<int64_t>::max();
+
+// an OBJ index is absolute, or relative to the start of the chunk it was read
+// in when it was negative in the file: the chunk doesn't know how many
+// vertices came before it
+struct ObjCorner {
+    int64_t position;
+    int64_t normal;
+    bool positionRelative;
+    bool normalRelative;
+};
+
+struct ObjChunk {
+    vector<glm::vec3> positions;
+    vector<glm::vec4> colors;
+    vector<glm::vec3> normals;
+    vector<ObjCorner> corners;
+    bool hasColors = false;
+};
+
+string ReadObjFile(const string& path)
+{
+    ifstream file{path, ios::binary};
+    if (!file)
+        throw runtime_error{"Unable to open " + path};
+
+    return string{istreambuf_iterator<char>{file}, istreambuf_iterator<char>{}};
+}
+
+bool IsObjSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* SkipObjSpaces(const char* p, const char* end)
+{
+    while (p < end && IsObjSpace(*p))
+        ++p;
+
+    return p;
+}
+
+// the buffer is a std::string, strtof always finds a terminator; it also
+// skips newlines, so a number must start and end before the end of the line
+float ParseObjFloat(const char*& p, const char* end)
+{
+    p = SkipObjSpaces(p, end);
+    if (p >= end || isspace(static_cast<unsigned char>(*p)))
+        throw runtime_error{"Malformed OBJ number"};
+
+    char* next = nullptr;
+    const auto value = strtof(p, &next);
+    if (next == p || next > end)
+        throw runtime_error{"Malformed OBJ number"};
+
+    p = next;
+    return value;
+}
+
+// the number of space separated tokens left on the line
+size_t CountObjTokens(const char* p, const char* end)
+{
+    size_t tokens = 0;
+
+    for (p = SkipObjSpaces(p, end); p < end; p = SkipObjSpaces(p, end))
+    {
+        ++tokens;
+        while (p < end && !IsObjSpace(*p))
+            ++p;
+    }
+
+    return tokens;
+}
+
+bool ParseObjIndex(const char*& p, const char* end, size_t localCount, int64_t& index, bool& relative)
+{
+    if (p >= end || isspace(static_cast<unsigned char>(*p)))
+        return false;
+
+    char* next = nullptr;
+    const auto value = strtoll(p, &next, 10);
+    if (next == p || next > end)
+        return false;
+
+    p = next;
+
+    if (value == 0)
+        throw runtime_error{"OBJ indices start at 1"};
+
+    relative = value < 0;
+    index = relative ? int64_t(localCount) + value : value - 1;
+    return true;
+}
+
+void ParseObjFace(const char* p, const char* end, ObjChunk& chunk, vector<ObjCorner>& polygon)
+{
+    polygon.clear();
+
+    for (p = SkipObjSpaces(p, end); p < end; p = SkipObjSpaces(p, end))
+    {
+        ObjCorner corner{0, objMissing, false, false};
+        if (!ParseObjIndex(p, end, chunk.positions.size(), corner.position, corner.positionRelative))
+            throw runtime_error{"Malformed OBJ face"};
+
+        // p, p/t, p//n or p/t/n, texture coordinates are skipped
+        if (p < end && *p == '/')
+        {
+            ++p;
+            int64_t texture;
+            bool textureRelative;
+            ParseObjIndex(p, end, 0, texture, textureRelative);
+
+            if (p < end && *p == '/')
+            {
+                ++p;
+                if (!ParseObjIndex(p, end, chunk.normals.size(), corner.normal, corner.normalRelative))
+                    throw runtime_error{"Malformed OBJ face"};
+            }
+        }
+
+        polygon.push_back(corner);
+    }
+
+    for (size_t i = 2; i < polygon.size(); ++i)
+        chunk.corners.insert(std::end(chunk.corners), {polygon[0], polygon[i - 1], polygon[i]});
+}
+
+void ParseObjChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    vector<ObjCorner> polygon;
+
+    for (auto line = begin; line < end; )
+    {
+        auto lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (!lineEnd)
+            lineEnd = end;
+
+        auto p = SkipObjSpaces(line, lineEnd);
+
+        if (lineEnd - p > 2 && p[0] == 'v' && IsObjSpace(p[1]))
+        {
+            p += 2;
+            const auto x = ParseObjFloat(p, lineEnd);
+            const auto y = ParseObjFloat(p, lineEnd);
+            const auto z = ParseObjFloat(p, lineEnd);
+            chunk.positions.push_back(glm::vec3{x, y, z});
+
+            // "v x y z w" with a weight that only matters for rational
+            // curves, or the common "v x y z r g b" extension
+            glm::vec4 color{1.0f};
+            const auto extra = CountObjTokens(p, lineEnd);
+
+            if (extra == 1)
+                ParseObjFloat(p, lineEnd);
+            else if (extra == 3)
+            {
+                color.x = ParseObjFloat(p, lineEnd);
+                color.y = ParseObjFloat(p, lineEnd);
+                color.z = ParseObjFloat(p, lineEnd);
+                chunk.hasColors = true;
+            }
+            else if (extra != 0)
+                throw runtime_error{"Malformed OBJ vertex"};
+
+            chunk.colors.push_back(color);
+        }
+        else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n' && IsObjSpace(p[2]))
+        {
+            p += 3;
+            const auto x = ParseObjFloat(p, lineEnd);
+            const auto y = ParseObjFloat(p, lineEnd);
+            const auto z = ParseObjFloat(p, lineEnd);
+            chunk.normals.push_back(glm::vec3{x, y, z});
+        }
+        else if (lineEnd - p > 2 && p[0] == 'f' && IsObjSpace(p[1]))
+            ParseObjFace(p + 2, lineEnd, chunk, polygon);
+
+        line = lineEnd + 1;
+    }
+}
+
+// chunk boundaries right after a newline, so no line is split
+vector<const char*> SplitObjLines(const string& text, unsigned chunks)
+{
+    vector<const char*> bounds{text.data()};
+    const auto end = text.data() + text.size();
+
+    for (unsigned i = 1; i < chunks; ++i)
+    {
+        auto p = max(bounds.back(), text.data() + text.size() * i / chunks);
+        auto newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        bounds.push_back(newline ? newline + 1 : end);
+    }
+
+    bounds.push_back(end);
+    return bounds;
+}
+
+uint64_t MixKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return key;
+}
+
+int64_t ResolveObjIndex(int64_t index, bool relative, size_t chunkOffset, size_t count)
+{
+    const auto resolved = relative ? int64_t(chunkOffset) + index : index;
+    if (resolved < 0 || resolved >= int64_t(count))
+        throw runtime_error{"OBJ index out of range"};
+
+    return resolved;
+}
+
+} // detail
+
+ostream& operator << (ostream& out, const ImportStats& stats)
+{
+    const auto seconds = stats.ms / 1.0e3;
+
+    return out << "{\"bytes\": " << stats.bytes
+               << ", \"vertices\": " << stats.vertices
+               << ", \"triangles\": " << stats.triangles
+               << ", \"threads\": " << stats.threads
+               << ", \"ms\": " << stats.ms
+               << ", \"mb_per_s\": " << (seconds > 0.0 ? stats.bytes / seconds / 1.0e6 : 0.0)
+               << ", \"triangles_per_s\": " << (seconds > 0.0 ? stats.triangles / seconds : 0.0) << "}";
+}
+
+MeshData ImportObj(const string& path, unsigned threads, ImportStats* stats)
+{
+    Stopwatch timer;
+
+    const auto text = detail::ReadObjFile(path);
+    const auto workers = ParallelWorkers(text.size() / 4096 + 1, threads);
+    const auto bounds = detail::SplitObjLines(text, workers);
+
+    vector<detail::ObjChunk> chunks(workers);
+    ParallelFor(workers, workers, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto c = begin; c < end; ++c)
+            detail::ParseObjChunk(bounds[c], bounds[c + 1], chunks[c]);
+    });
+
+    // where every chunk starts in the file wide arrays
+    vector<size_t> positionOffset(workers + 1, 0);
+    vector<size_t> normalOffset(workers + 1, 0);
+    vector<size_t> cornerOffset(workers + 1, 0);
+    auto hasColors = false;
+
+    for (unsigned c = 0; c < workers; ++c)
+    {
+        positionOffset[c + 1] = positionOffset[c] + chunks[c].positions.size();
+        normalOffset[c + 1] = normalOffset[c] + chunks[c].normals.size();
+        cornerOffset[c + 1] = cornerOffset[c] + chunks[c].corners.size();
+        hasColors = hasColors || chunks[c].hasColors;
+    }
+
+    const auto positionCount = positionOffset[workers];
+    const auto normalCount = normalOffset[workers];
+    const auto cornerCount = cornerOffset[workers];
+
+    if (positionCount >= numeric_limits<uint32_t>::max() || normalCount >= numeric_limits<uint32_t>::max())
+        throw runtime_error{path + " has too many vertices"};
+
+    // corner keys: position index in the low half, normal index + 1 (0 for
+    // none) in the high one
+    vector<uint64_t> keys(cornerCount);
+    ParallelFor(workers, workers, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto c = begin; c < end; ++c)
+        {
+            auto key = keys.data() + cornerOffset[c];
+
+            for (const auto& corner : chunks[c].corners)
+            {
+                const auto position = detail::ResolveObjIndex(corner.position, corner.positionRelative,
+                                                              positionOffset[c], positionCount);
+                const auto normal = corner.normal == detail::objMissing ? -1 :
+                    detail::ResolveObjIndex(corner.normal, corner.normalRelative, normalOffset[c], normalCount);
+
+                *key++ = uint64_t(position) | uint64_t(normal + 1) << 32;
+            }
+        }
+    });
+
+    // every worker owns the keys that hash to it, scans all of them and
+    // numbers the ones it owns in order of first use
+    const auto partitions = ParallelWorkers(cornerCount, threads);
+    auto partitionOf = [&](uint64_t key)
+    {
+        return unsigned(detail::MixKey(key) % partitions);
+    };
+
+    vector<GLuint> cornerVertex(cornerCount);
+    vector<vector<uint64_t>> partitionKeys(partitions);
+
+    ParallelFor(partitions, partitions, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto part = begin; part < end; ++part)
+        {
+            unordered_map<uint64_t, GLuint> vertexOf;
+            vertexOf.reserve(cornerCount / partitions);
+
+            for (size_t i = 0; i < cornerCount; ++i)
+            {
+                if (partitionOf(keys[i]) != part)
+                    continue;
+
+                const auto inserted = vertexOf.emplace(keys[i], GLuint(partitionKeys[part].size()));
+                if (inserted.second)
+                    partitionKeys[part].push_back(keys[i]);
+
+                cornerVertex[i] = inserted.first->second;
+            }
+        }
+    });
+
+    vector<size_t> vertexOffset(partitions + 1, 0);
+    for (unsigned part = 0; part < partitions; ++part)
+        vertexOffset[part + 1] = vertexOffset[part] + partitionKeys[part].size();
+
+    const auto vertexCount = vertexOffset[partitions];
+
+    // the chunk arrays, flattened to resolve keys against
+    vector<glm::vec3> positions(positionCount);
+    vector<glm::vec4> colors(hasColors ? positionCount : 0);
+    vector<glm::vec3> normals(normalCount);
+
+    ParallelFor(workers, workers, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto c = begin; c < end; ++c)
+        {
+            copy(std::begin(chunks[c].positions), std::end(chunks[c].positions), std::begin(positions) + positionOffset[c]);
+            copy(std::begin(chunks[c].normals), std::end(chunks[c].normals), std::begin(normals) + normalOffset[c]);
+            if (hasColors)
+                copy(std::begin(chunks[c].colors), std::end(chunks[c].colors), std::begin(colors) + positionOffset[c]);
+        }
+    });
+
+    MeshData mesh;
+    mesh.positions.resize(vertexCount);
+    mesh.colors.resize(hasColors ? vertexCount : 0);
+    mesh.normals.resize(normalCount ? vertexCount : 0);
+    mesh.indices.resize(cornerCount);
+
+    ParallelFor(partitions, partitions, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto part = begin; part < end; ++part)
+        {
+            auto vertex = vertexOffset[part];
+
+            for (auto key : partitionKeys[part])
+            {
+                const auto position = key & 0xffffffffull;
+                const auto normal = key >> 32;
+
+                mesh.positions[vertex] = positions[position];
+                if (hasColors)
+                    mesh.colors[vertex] = colors[position];
+                if (normalCount)
+                    mesh.normals[vertex] = normal ? normals[normal - 1] : glm::vec3{0.0f};
+
+                ++vertex;
+            }
+        }
+    });
+
+    ParallelFor(cornerCount, threads, [&](size_t begin, size_t end, unsigned)
+    {
+        for (auto i = begin; i < end; ++i)
+            mesh.indices[i] = GLuint(vertexOffset[partitionOf(keys[i])] + cornerVertex[i]);
+    });
+
+    if (!normalCount)
+        ComputeNormals(mesh);
+
+    if (stats)
+        *stats = ImportStats{text.size(), mesh.positions.size(), mesh.indices.size() / 3,
+                             max(workers, partitions), timer.elapsedMs()};
+
+    return mesh;
+}
+
+MeshData ImportMesh(const string& path, unsigned threads, ImportStats* stats)
+{
+    auto extension = path.substr(min(path.size(), path.rfind('.')));
+    transform(begin(extension), end(extension), begin(extension), [](char c) { return char(tolower(c)); });
+
+    if (extension == ".obj")
+        return ImportObj(path, threads, stats);
+
+    if (extension == ".gltf" || extension == ".glb")
+        return ImportGltf(path, threads, stats);
+
+    throw runtime_error{"Unknown mesh file type " + path};
+}
+
+void ComputeNormals(MeshData& mesh)
+{
+    // unnormalized face normals are twice the triangle area long
+    vector<glm::vec3> normals(mesh.positions.size(), glm::vec3{0.0f});
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const auto a = mesh.indices[i];
+        const auto b = mesh.indices[i + 1];
+        const auto c = mesh.indices[i + 2];
+
+        const auto face = glm::cross(mesh.positions[b] - mesh.positions[a], mesh.positions[c] - mesh.positions[a]);
+        normals[a] += face;
+        normals[b] += face;
+        normals[c] += face;
+    }
+
+    for (auto& normal : normals)
+    {
+        const auto length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : glm::vec3{0.0f, 0.0f, 1.0f};
+    }
+
+    mesh.normals = move(normals);
+}
@@ -0,0 +1,446 @@
+#include "mesh_lod.h"
+#include "camera.h"
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+// sum of squared distances to a set of planes, each weighted by the area of
+// its triangle; weight is that total area
+struct LodQuadric {
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+    double weight = 0.0;
+
+    void addPlane(const glm::vec3& n, double d, double w)
+    {
+        a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+        b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+        c2 += w * n.z * n.z; cd += w * n.z * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    LodQuadric& operator += (const LodQuadric& q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+        const auto error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                         + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+                         + c2 * z * z + 2.0 * cd * z
+                         + d2;
+        return max(error, 0.0);
+    }
+};
+
+struct LodCollapse {
+    double cost;
+    GLuint from;
+    GLuint to;
+};
+
+// the first vertex of every group of equal ones; with attributes false only
+// the positions are compared
+vector<GLuint> WeldLodVertices(const MeshData& mesh, bool attributes)
+{
+    using Key = array<float, 10>;
+
+    auto key = [&](GLuint v)
+    {
+        Key k{};
+        const auto& p = mesh.positions[v];
+        k[0] = p.x; k[1] = p.y; k[2] = p.z;
+
+        if (attributes && !mesh.colors.empty())
+        {
+            const auto& c = mesh.colors[v];
+            k[3] = c.x; k[4] = c.y; k[5] = c.z; k[6] = c.w;
+        }
+
+        if (attributes && !mesh.normals.empty())
+        {
+            const auto& n = mesh.normals[v];
+            k[7] = n.x; k[8] = n.y; k[9] = n.z;
+        }
+
+        return k;
+    };
+
+    vector<GLuint> order(mesh.positions.size());
+    iota(begin(order), end(order), 0);
+    stable_sort(begin(order), end(order), [&](GLuint a, GLuint b) { return key(a) < key(b); });
+
+    vector<GLuint> first(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        first[order[i]] = i > 0 && key(order[i]) == key(order[i - 1]) ? first[order[i - 1]] : order[i];
+
+    return first;
+}
+
+glm::vec3 LodFaceNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    return glm::cross(b - a, c - a);
+}
+
+// drops triangles with two corners at the same position
+void RemoveLodDegenerates(vector<GLuint>& indices, const vector<GLuint>& position)
+{
+    size_t kept = 0;
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const auto a = position[indices[i]];
+        const auto b = position[indices[i + 1]];
+        const auto c = position[indices[i + 2]];
+
+        if (a == b || b == c || a == c)
+            continue;
+
+        copy(begin(indices) + i, begin(indices) + i + 3, begin(indices) + kept);
+        kept += 3;
+    }
+
+    indices.resize(kept);
+}
+
+} // detail
+
+vector<GLuint> SimplifyMesh(const MeshData& mesh, const vector<GLuint>& indices,
+                            size_t targetTriangles, float* error)
+{
+    const auto vertexCount = mesh.positions.size();
+
+    if (indices.size() % 3)
+        throw invalid_argument{"SimplifyMesh needs a triangle list"};
+
+    for (auto index : indices)
+        if (index >= vertexCount)
+            throw out_of_range{"SimplifyMesh index past the last vertex"};
+
+    // exact duplicates (the seam column of a uv sphere) are one vertex, a
+    // position with several different vertices on it is an attribute seam
+    const auto wedge = detail::WeldLodVertices(mesh, true);
+    const auto position = detail::WeldLodVertices(mesh, false);
+
+    vector<GLuint> result(indices.size());
+    transform(begin(indices), end(indices), begin(result), [&](GLuint v) { return wedge[v]; });
+    detail::RemoveLodDegenerates(result, position);
+
+    vector<bool> locked(vertexCount, false);
+    vector<GLuint> firstWedge(vertexCount, ~0u);
+
+    for (GLuint v = 0; v < vertexCount; ++v)
+    {
+        auto& seen = firstWedge[position[v]];
+        if (seen == ~0u)
+            seen = wedge[v];
+        else if (seen != wedge[v])
+            locked[position[v]] = true;
+    }
+
+    // open and non manifold edges keep both their ends
+    vector<uint64_t> edges;
+    edges.reserve(result.size());
+
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+        const uint64_t a = position[result[i]];
+        const uint64_t b = position[result[i - i % 3 + (i + 1) % 3]];
+        edges.push_back(min(a, b) << 32 | max(a, b));
+    }
+
+    sort(begin(edges), end(edges));
+
+    for (size_t i = 0; i < edges.size(); )
+    {
+        auto j = i;
+        while (j < edges.size() && edges[j] == edges[i])
+            ++j;
+
+        if (j - i != 2)
+        {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & 0xffffffffull] = true;
+        }
+
+        i = j;
+    }
+
+    vector<detail::LodQuadric> quadrics(vertexCount);
+
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const auto& a = mesh.positions[result[i]];
+        const auto normal = detail::LodFaceNormal(a, mesh.positions[result[i + 1]], mesh.positions[result[i + 2]]);
+        const auto length = glm::length(normal);
+        if (length <= 0.0f)
+            continue;
+
+        const auto n = normal / length;
+        for (int corner = 0; corner < 3; ++corner)
+            quadrics[position[result[i + corner]]].addPlane(n, -glm::dot(n, a), length * 0.5);
+    }
+
+    float maxError = 0.0f;
+    vector<detail::LodCollapse> collapses;
+    vector<bool> touched(vertexCount);
+    vector<size_t> offsets(vertexCount + 1);
+    vector<size_t> around(result.size());
+
+    while (result.size() / 3 > targetTriangles)
+    {
+        // position -> triangles
+        fill(begin(offsets), end(offsets), 0);
+        for (auto v : result)
+            ++offsets[position[v] + 1];
+
+        partial_sum(begin(offsets), end(offsets), begin(offsets));
+        auto next = offsets;
+        around.resize(result.size());
+
+        for (size_t i = 0; i < result.size(); ++i)
+            around[next[position[result[i]]]++] = i / 3;
+
+        // every directed edge of every triangle is a candidate, the vertex
+        // moves onto the corner it shares a triangle with so it takes that
+        // corner's attributes; the merged vertex answers for the planes of
+        // both ends
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            const auto from = result[i];
+            const auto to = result[i - i % 3 + (i + 1) % 3];
+
+            auto merged = quadrics[position[from]];
+            merged += quadrics[position[to]];
+            for (auto edge : {make_pair(from, to), make_pair(to, from)})
+                if (!locked[position[edge.first]])
+                    collapses.push_back(detail::LodCollapse{
+                        merged.evaluate(mesh.positions[edge.second]), edge.first, edge.second});
+        }
+
+        sort(begin(collapses), end(collapses),
+             [](const detail::LodCollapse& a, const detail::LodCollapse& b) { return a.cost < b.cost; });
+
+        fill(begin(touched), end(touched), false);
+        const auto goal = result.size() / 3 - targetTriangles;
+        size_t removed = 0;
+
+        for (const auto& collapse : collapses)
+        {
+            if (removed >= goal)
+                break;
+
+            const auto from = position[collapse.from];
+            const auto to = position[collapse.to];
+            if (touched[from] || touched[to])
+                continue;
+
+            // no triangle around from may turn over when it moves
+            auto flips = false;
+            size_t shared = 0;
+            const auto& target = mesh.positions[collapse.to];
+
+            for (auto t = offsets[from]; t < offsets[from + 1] && !flips; ++t)
+            {
+                const auto triangle = &result[around[t] * 3];
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                auto hasTo = false;
+
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    before[corner] = after[corner] = mesh.positions[triangle[corner]];
+                    if (position[triangle[corner]] == from)
+                        after[corner] = target;
+                    hasTo = hasTo || position[triangle[corner]] == to;
+                }
+
+                if (hasTo)
+                {
+                    ++shared;
+                    continue;
+                }
+
+                const auto n0 = detail::LodFaceNormal(before[0], before[1], before[2]);
+                const auto n1 = detail::LodFaceNormal(after[0], after[1], after[2]);
+                flips = glm::dot(n0, n1) <= 0.0f;
+            }
+
+            if (flips)
+                continue;
+
+            for (auto t = offsets[from]; t < offsets[from + 1]; ++t)
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    auto& index = result[around[t] * 3 + corner];
+                    if (position[index] == from)
+                        index = collapse.to;
+                }
+
+            quadrics[to] += quadrics[from];
+
+            const auto weight = quadrics[to].weight;
+            if (weight > 0.0)
+                maxError = max(maxError, static_cast<float>(sqrt(collapse.cost / weight)));
+            touched[from] = touched[to] = true;
+            removed += max<size_t>(shared, 1);
+        }
+
+        if (removed == 0)
+            break;
+
+        detail::RemoveLodDegenerates(result, position);
+    }
+
+    if (error)
+        *error = maxError;
+
+    return result;
+}
+
+LodChain GenerateLodChain(MeshData mesh, size_t maxLevels, float reduction, size_t minTriangles)
+{
+    const auto vertexCount = mesh.positions.size();
+
+    vector<vector<GLuint>> levels{mesh.indices};
+    vector<float> errors{0.0f};
+    OptimizeVertexCache(levels.front(), vertexCount);
+
+    while (levels.size() < maxLevels)
+    {
+        const auto triangles = levels.back().size() / 3;
+        const auto target = static_cast<size_t>(triangles * reduction);
+        if (target < minTriangles)
+            break;
+
+        float error;
+        auto level = SimplifyMesh(mesh, levels.back(), target, &error);
+
+        // locked borders and seams can leave little to collapse
+        if (level.size() / 3 > triangles * (1.0f + reduction) / 2.0f)
+            break;
+
+        OptimizeVertexCache(level, vertexCount);
+
+        // each level is simplified from the one before, so errors add up
+        errors.push_back(errors.back() + error);
+        levels.push_back(move(level));
+    }
+
+    LodChain chain;
+    chain.mesh = move(mesh);
+    chain.mesh.indices.clear();
+
+    for (size_t l = 0; l < levels.size(); ++l)
+    {
+        const auto first = static_cast<uint32_t>(chain.mesh.indices.size());
+        chain.mesh.indices.insert(end(chain.mesh.indices), begin(levels[l]), end(levels[l]));
+        chain.levels.push_back(LodLevel{Submesh{first, static_cast<uint32_t>(levels[l].size()), 0}, errors[l]});
+    }
+
+    OptimizeVertexFetch(chain.mesh);
+    return chain;
+}
+
+ostream& operator << (ostream& out, const LodFrameStats& stats)
+{
+    const auto saved = stats.fullTriangles ? 1.0 - double(stats.drawnTriangles) / stats.fullTriangles : 0.0;
+
+    return out << "{\"objects\": " << stats.objects
+               << ", \"full_triangles\": " << stats.fullTriangles
+               << ", \"drawn_triangles\": " << stats.drawnTriangles
+               << ", \"saved\": " << saved
+               << ", \"switches\": " << stats.switches << "}";
+}
+
+LodSelector::LodSelector(float viewportHeight, float threshold, float hysteresis)
+    : m_viewportHeight{viewportHeight}
+    , m_threshold{threshold}
+    , m_hysteresis{hysteresis}
+    , m_eye{0.0f}
+    , m_pixelsPerUnit{0.0f}
+    , m_perspective{true}
+    , m_stats{0, 0, 0, 0}
+{
+}
+
+void LodSelector::beginFrame(const Camera& camera)
+{
+    const auto& projection = camera.projection();
+
+    // y scale is 1 / tan(fov / 2) for perspective, 2 / height for ortho, and
+    // only perspective has w depend on z
+    m_eye = camera.position();
+    m_perspective = projection[2][3] != 0.0f;
+    m_pixelsPerUnit = projection[1][1] * m_viewportHeight * 0.5f;
+    m_stats = LodFrameStats{0, 0, 0, 0};
+}
+
+float LodSelector::projectedError(float error, float distance) const noexcept
+{
+    if (!m_perspective)
+        return error * m_pixelsPerUnit;
+
+    return distance > 0.0f ? error * m_pixelsPerUnit / distance : numeric_limits<float>::max();
+}
+
+size_t LodSelector::select(const LodChain& chain, const MeshBounds& bounds, const glm::mat4& world,
+                           size_t current)
+{
+    if (chain.levels.empty())
+        throw invalid_argument{"LodChain without levels"};
+
+    const auto center4 = world * glm::vec4{bounds.center, 1.0f};
+    const glm::vec3 center{center4.x, center4.y, center4.z};
+
+    // errors and bounds scale with the largest axis of the transform
+    auto axis = [&](int i) { return glm::length(glm::vec3{world[i].x, world[i].y, world[i].z}); };
+    const auto scale = max(axis(0), max(axis(1), axis(2)));
+    const auto radius = glm::length(bounds.extent) * scale;
+
+    // the nearest point of the bounding sphere, inside it is distance 0
+    const auto distance = max(glm::distance(m_eye, center) - radius, 0.0f);
+
+    auto coarsest = [&](size_t from, float pixels)
+    {
+        auto level = from;
+        while (level + 1 < chain.levels.size() &&
+               projectedError(chain.levels[level + 1].error * scale, distance) <= pixels)
+            ++level;
+
+        return level;
+    };
+
+    current = min(current, chain.levels.size() - 1);
+    auto level = coarsest(0, m_threshold);
+
+    if (level > current)
+        level = coarsest(current, m_threshold * (1.0f - m_hysteresis));
+
+    ++m_stats.objects;
+    m_stats.fullTriangles += chain.levels.front().submesh.indexCount / 3;
+    m_stats.drawnTriangles += chain.levels[level].submesh.indexCount / 3;
+    m_stats.switches += level != current ? 1 : 0;
+
+    return level;
+}
@@ -0,0 +1,349 @@
+#include "mesh_optimizer.h"
+#include "mesh_adjacency.h"
+#include "stopwatch.h"
+#include <algorithm>
+#include <ostream>
+
+using namespace std;
+
+namespace detail {
+
+// FIFO cache simulation, a vertex is cached while fewer than size misses
+// happened since it was loaded
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, size_t size)
+        : m_loaded(vertexCount, 0)
+        , m_size{size}
+        , m_time{size + 1}
+    {
+    }
+
+    // true on a miss
+    bool touch(GLuint vertex)
+    {
+        if (m_time - m_loaded[vertex] <= m_size)
+            return false;
+
+        m_loaded[vertex] = m_time++;
+        return true;
+    }
+
+    void reset()
+    {
+        m_time += m_size + 1;
+    }
+
+private:
+    vector<size_t> m_loaded;
+    size_t m_size;
+    size_t m_time;
+};
+
+size_t CountMisses(const vector<GLuint>& indices, size_t begin, size_t end, FifoCache& cache)
+{
+    size_t misses = 0;
+    for (auto i = begin * 3; i < end * 3; ++i)
+        misses += cache.touch(indices[i]) ? 1 : 0;
+
+    return misses;
+}
+
+} // detail
+
+ostream& operator << (ostream& out, const VertexCacheStats& stats)
+{
+    return out << "{\"acmr\": " << stats.acmr << ", \"atvr\": " << stats.atvr << "}";
+}
+
+VertexCacheStats AnalyzeVertexCache(const vector<GLuint>& indices, size_t vertexCount,
+                                    size_t cacheSize)
+{
+    CheckTriangleList(indices, vertexCount);
+
+    detail::FifoCache cache{vertexCount, cacheSize};
+    const auto misses = detail::CountMisses(indices, 0, indices.size() / 3, cache);
+
+    vector<bool> used(vertexCount, false);
+    for (auto index : indices)
+        used[index] = true;
+
+    const auto referenced = count(begin(used), end(used), true);
+
+    return VertexCacheStats{
+        indices.empty() ? 0.0 : 3.0 * misses / indices.size(),
+        referenced == 0 ? 0.0 : double(misses) / referenced
+    };
+}
+
+vector<size_t> OptimizeVertexCache(vector<GLuint>& indices, size_t vertexCount, size_t cacheSize)
+{
+    CheckTriangleList(indices, vertexCount);
+
+    const auto triangleCount = indices.size() / 3;
+    const auto adjacency = BuildTriangleAdjacency(indices, vertexCount);
+
+    vector<size_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    vector<size_t> cacheTime(vertexCount, 0);
+    vector<bool> emitted(triangleCount, false);
+    vector<GLuint> deadEnds;
+    vector<GLuint> candidates;
+    vector<GLuint> result;
+    vector<size_t> clusters;
+    result.reserve(indices.size());
+
+    auto time = cacheSize + 1;
+    GLuint cursor = 0;
+
+    // a vertex still used by some triangle, first the recently emitted ones
+    // then in index order; -1 when everything is out
+    auto skipDeadEnd = [&]() -> long long
+    {
+        while (!deadEnds.empty())
+        {
+            const auto d = deadEnds.back();
+            deadEnds.pop_back();
+
+            if (live[d] > 0)
+                return d;
+        }
+
+        for (; cursor < vertexCount; ++cursor)
+            if (live[cursor] > 0)
+                return cursor;
+
+        return -1;
+    };
+
+    // the candidate that stays in the cache after fanning all of its
+    // triangles and was loaded the earliest, -1 when none would
+    auto next = [&]() -> long long
+    {
+        long long best = -1;
+        size_t bestPriority = 0;
+
+        for (auto v : candidates)
+        {
+            if (live[v] == 0)
+                continue;
+
+            size_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = time - cacheTime[v];
+
+            if (priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+
+        return best;
+    };
+
+    for (auto fan = skipDeadEnd(); fan >= 0; )
+    {
+        candidates.clear();
+
+        for (auto i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; ++i)
+        {
+            const auto triangle = adjacency.triangles[i];
+            if (emitted[triangle])
+                continue;
+
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                const auto v = indices[triangle * 3 + corner];
+
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+
+            emitted[triangle] = true;
+        }
+
+        fan = next();
+        if (fan < 0)
+        {
+            fan = skipDeadEnd();
+            if (fan >= 0 && result.size() < indices.size())
+                clusters.push_back(result.size() / 3);
+        }
+    }
+
+    indices = move(result);
+    clusters.insert(begin(clusters), 0);
+    clusters.erase(unique(begin(clusters), end(clusters)), end(clusters));
+    return clusters;
+}
+
+void OptimizeOverdraw(vector<GLuint>& indices, const vector<glm::vec3>& positions,
+                      const vector<size_t>& clusters, float threshold, size_t cacheSize)
+{
+    CheckTriangleList(indices, positions.size());
+
+    const auto triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // soft boundaries: cut a cluster wherever the part so far is already as
+    // cache friendly as the whole cluster, within threshold
+    vector<size_t> splits;
+    detail::FifoCache cache{positions.size(), cacheSize};
+
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const auto first = clusters[c];
+        const auto last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        cache.reset();
+        const auto clusterAcmr = double(detail::CountMisses(indices, first, last, cache)) / (last - first);
+
+        cache.reset();
+        splits.push_back(first);
+
+        size_t misses = 0;
+        auto start = first;
+        for (auto t = first; t < last; ++t)
+        {
+            misses += detail::CountMisses(indices, t, t + 1, cache);
+
+            if (t + 1 < last && double(misses) / (t + 1 - start) <= clusterAcmr * threshold)
+            {
+                splits.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    splits.push_back(triangleCount);
+
+    glm::vec3 meshCenter{0.0f};
+    for (const auto& p : positions)
+        meshCenter += p;
+    meshCenter /= float(max<size_t>(positions.size(), 1));
+
+    struct Cluster {
+        size_t first;
+        size_t last;
+        float key;
+    };
+
+    vector<Cluster> order;
+    order.reserve(splits.size() - 1);
+
+    for (size_t s = 0; s + 1 < splits.size(); ++s)
+    {
+        // area weighted centroid and normal
+        glm::vec3 centroid{0.0f};
+        glm::vec3 normal{0.0f};
+        float area = 0.0f;
+
+        for (auto t = splits[s]; t < splits[s + 1]; ++t)
+        {
+            const auto& a = positions[indices[t * 3 + 0]];
+            const auto& b = positions[indices[t * 3 + 1]];
+            const auto& c = positions[indices[t * 3 + 2]];
+
+            const auto n = glm::cross(b - a, c - a);
+            const auto weight = glm::length(n) * 0.5f;
+
+            centroid += (a + b + c) * (weight / 3.0f);
+            normal += n;
+            area += weight;
+        }
+
+        if (area > 0.0f)
+            centroid /= area;
+
+        const auto length = glm::length(normal);
+        const auto key = length > 0.0f ? glm::dot(centroid - meshCenter, normal / length) : 0.0f;
+
+        order.push_back(Cluster{splits[s], splits[s + 1], key});
+    }
+
+    stable_sort(begin(order), end(order), [](const Cluster& a, const Cluster& b)
+    {
+        return a.key > b.key;
+    });
+
+    vector<GLuint> result;
+    result.reserve(indices.size());
+
+    for (const auto& cluster : order)
+        result.insert(end(result), begin(indices) + cluster.first * 3, begin(indices) + cluster.last * 3);
+
+    indices = move(result);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+    CheckTriangleList(mesh.indices, mesh.positions.size());
+
+    const auto unused = ~0u;
+    vector<GLuint> remap(mesh.positions.size(), unused);
+    GLuint next = 0;
+
+    for (auto& index : mesh.indices)
+    {
+        if (remap[index] == unused)
+            remap[index] = next++;
+
+        index = remap[index];
+    }
+
+    auto reorder = [&](auto& attribute)
+    {
+        if (attribute.empty())
+            return;
+
+        typename remove_reference<decltype(attribute)>::type result(next);
+        for (size_t v = 0; v < remap.size(); ++v)
+            if (remap[v] != unused)
+                result[remap[v]] = attribute[v];
+
+        attribute = move(result);
+    };
+
+    reorder(mesh.positions);
+    reorder(mesh.colors);
+    reorder(mesh.normals);
+}
+
+ostream& operator << (ostream& out, const MeshOptimizationReport& report)
+{
+    return out << "{\"before\": " << report.before
+               << ", \"after\": " << report.after
+               << ", \"vertices_before\": " << report.verticesBefore
+               << ", \"vertices_after\": " << report.verticesAfter
+               << ", \"ms\": " << report.ms << "}";
+}
+
+MeshOptimizationReport OptimizeMesh(MeshData& mesh)
+{
+    MeshOptimizationReport report;
+    report.verticesBefore = mesh.positions.size();
+    report.before = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    Stopwatch timer;
+
+    const auto clusters = OptimizeVertexCache(mesh.indices, mesh.positions.size());
+    OptimizeOverdraw(mesh.indices, mesh.positions, clusters);
+    OptimizeVertexFetch(mesh);
+
+    report.ms = timer.elapsedMs();
+    report.verticesAfter = mesh.positions.size();
+    report.after = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    return report;
+}
@@ -0,0 +1,189 @@
+#include "mesh_strip.h"
+#include "mesh_adjacency.h"
+#include <algorithm>
+#include <ostream>
+
+using namespace std;
+
+namespace detail {
+
+const size_t noStripTriangle = ~size_t{0};
+
+class StripBuilder {
+public:
+    StripBuilder(const vector<GLuint>& indices, size_t vertexCount, size_t window)
+        : m_indices(indices)
+        , m_adjacency(BuildTriangleAdjacency(indices, vertexCount))
+        , m_emitted(indices.size() / 3, false)
+        , m_window{window}
+    {
+    }
+
+    // an unused triangle within the window with the directed edge from -> to,
+    // third gets its other vertex
+    size_t neighbour(GLuint from, GLuint to, size_t frontier, GLuint& third) const
+    {
+        for (auto a = m_adjacency.offsets[from]; a < m_adjacency.offsets[from + 1]; ++a)
+        {
+            const auto t = m_adjacency.triangles[a];
+            if (m_emitted[t] || (m_window && t >= frontier + m_window))
+                continue;
+
+            for (size_t corner = 0; corner < 3; ++corner)
+                if (m_indices[t * 3 + corner] == from && m_indices[t * 3 + (corner + 1) % 3] == to)
+                {
+                    third = m_indices[t * 3 + (corner + 2) % 3];
+                    return t;
+                }
+        }
+
+        return noStripTriangle;
+    }
+
+    vector<GLuint> build()
+    {
+        vector<GLuint> strips;
+        vector<GLuint> strip;
+        size_t frontier = 0;
+
+        while (true)
+        {
+            while (frontier < m_emitted.size() && m_emitted[frontier])
+                ++frontier;
+
+            if (frontier == m_emitted.size())
+                break;
+
+            strip.clear();
+            start(frontier, frontier, strip);
+
+            // odd triangles are drawn with their first two vertices swapped
+            while (true)
+            {
+                const auto n = strip.size();
+                const auto odd = n % 2 == 1;
+                GLuint third = 0;
+                const auto t = odd ? neighbour(strip[n - 1], strip[n - 2], frontier, third)
+                                   : neighbour(strip[n - 2], strip[n - 1], frontier, third);
+
+                if (t == noStripTriangle)
+                    break;
+
+                m_emitted[t] = true;
+                strip.push_back(third);
+            }
+
+            if (!strips.empty())
+                strips.push_back(primitiveRestart);
+
+            strips.insert(end(strips), begin(strip), end(strip));
+        }
+
+        return strips;
+    }
+
+private:
+    // the seed turned so its exit edge leads furthest, looking two
+    // triangles ahead
+    void start(size_t seed, size_t frontier, vector<GLuint>& strip)
+    {
+        m_emitted[seed] = true;
+
+        size_t bestRotation = 0;
+        size_t bestSteps = 0;
+
+        for (size_t rotation = 0; rotation < 3 && bestSteps < 2; ++rotation)
+        {
+            const auto b = m_indices[seed * 3 + (rotation + 1) % 3];
+            const auto c = m_indices[seed * 3 + (rotation + 2) % 3];
+
+            GLuint d = 0;
+            GLuint e = 0;
+            size_t steps = 0;
+            if (neighbour(c, b, frontier, d) != noStripTriangle)
+                steps = neighbour(c, d, frontier, e) != noStripTriangle ? 2 : 1;
+
+            if (steps > bestSteps)
+            {
+                bestRotation = rotation;
+                bestSteps = steps;
+            }
+        }
+
+        for (size_t corner = 0; corner < 3; ++corner)
+            strip.push_back(m_indices[seed * 3 + (bestRotation + corner) % 3]);
+    }
+
+private:
+    const vector<GLuint>& m_indices;
+    TriangleAdjacency m_adjacency;
+    vector<bool> m_emitted;
+    size_t m_window;
+};
+
+} // detail
+
+vector<GLuint> Stripify(const vector<GLuint>& indices, size_t vertexCount, size_t window)
+{
+    CheckTriangleList(indices, vertexCount);
+
+    return detail::StripBuilder{indices, vertexCount, window}.build();
+}
+
+vector<GLuint> UnstripIndices(const vector<GLuint>& strips)
+{
+    vector<GLuint> indices;
+    size_t first = 0;
+
+    for (size_t i = 0; i <= strips.size(); ++i)
+    {
+        if (i < strips.size() && strips[i] != primitiveRestart)
+            continue;
+
+        for (auto k = first; k + 2 < i; ++k)
+        {
+            const auto odd = (k - first) % 2 == 1;
+            const auto a = strips[odd ? k + 1 : k];
+            const auto b = strips[odd ? k : k + 1];
+            const auto c = strips[k + 2];
+
+            if (a != b && b != c && c != a)
+                indices.insert(end(indices), {a, b, c});
+        }
+
+        first = i + 1;
+    }
+
+    return indices;
+}
+
+ostream& operator << (ostream& out, const PrimitiveChoice& choice)
+{
+    return out << "{\"mode\": \"" << (choice.mode == GL_TRIANGLE_STRIP ? "strip" : "list") << "\""
+               << ", \"list_bytes\": " << choice.listBytes
+               << ", \"strip_bytes\": " << choice.stripBytes
+               << ", \"list\": " << choice.list
+               << ", \"strip\": " << choice.strip << "}";
+}
+
+PrimitiveChoice ChoosePrimitives(const vector<GLuint>& indices, size_t vertexCount,
+                                 float tolerance, size_t cacheSize)
+{
+    auto strips = Stripify(indices, vertexCount);
+
+    PrimitiveChoice choice{GL_TRIANGLES, {}, 0, 0, VertexCacheStats{0.0, 0.0}, VertexCacheStats{0.0, 0.0}};
+    choice.listBytes = PackIndices(indices, vertexCount).bytes.size();
+    choice.stripBytes = PackIndices(strips, vertexCount).bytes.size();
+    choice.list = AnalyzeVertexCache(indices, vertexCount, cacheSize);
+    choice.strip = AnalyzeVertexCache(UnstripIndices(strips), vertexCount, cacheSize);
+
+    if (choice.stripBytes < choice.listBytes && choice.strip.acmr <= choice.list.acmr * (1.0 + tolerance))
+    {
+        choice.mode = GL_TRIANGLE_STRIP;
+        choice.indices = move(strips);
+    }
+    else
+        choice.indices = indices;
+
+    return choice;
+}
@@ -0,0 +1,286 @@
+#include "meshlet.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "mesh_adjacency.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+const size_t noMeshlet = numeric_limits<size_t>::max();
+
+// bounding sphere around the box of the vertices, and the normal cone
+void ComputeMeshletBounds(Meshlet& meshlet, const vector<GLuint>& indices,
+                          const vector<glm::vec3>& positions)
+{
+    const auto first = begin(indices) + meshlet.firstIndex;
+    const auto last = first + meshlet.indexCount;
+
+    glm::vec3 low{numeric_limits<float>::max()};
+    glm::vec3 high{-numeric_limits<float>::max()};
+
+    for (auto i = first; i != last; ++i)
+    {
+        low = glm::min(low, positions[*i]);
+        high = glm::max(high, positions[*i]);
+    }
+
+    meshlet.center = (low + high) * 0.5f;
+    meshlet.radius = 0.0f;
+
+    for (auto i = first; i != last; ++i)
+        meshlet.radius = max(meshlet.radius, glm::distance(meshlet.center, positions[*i]));
+
+    vector<glm::vec3> normals;
+    glm::vec3 axis{0.0f};
+
+    for (auto i = first; i != last; i += 3)
+    {
+        const auto n = glm::cross(positions[i[1]] - positions[i[0]], positions[i[2]] - positions[i[0]]);
+        const auto length = glm::length(n);
+        if (length <= 0.0f)
+            continue;
+
+        normals.push_back(n / length);
+        axis += normals.back();
+    }
+
+    const auto axisLength = glm::length(axis);
+    meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3{0.0f, 0.0f, 1.0f};
+    meshlet.coneCutoff = 1.0f;
+
+    if (axisLength <= 0.0f)
+        return;
+
+    auto minDot = 1.0f;
+    for (const auto& n : normals)
+        minDot = min(minDot, glm::dot(meshlet.coneAxis, n));
+
+    // wider than a half space can't be back facing as a whole
+    if (minDot > 0.0f)
+        meshlet.coneCutoff = sqrt(1.0f - minDot * minDot);
+}
+
+} // detail
+
+vector<Meshlet> BuildMeshlets(MeshData& mesh, size_t maxTriangles, size_t maxVertices)
+{
+    const auto& indices = mesh.indices;
+    const auto vertexCount = mesh.positions.size();
+
+    CheckTriangleList(indices, vertexCount);
+
+    if (maxTriangles == 0 || maxVertices < 3)
+        throw invalid_argument{"Meshlets need room for a triangle"};
+
+    const auto triangleCount = indices.size() / 3;
+    const auto adjacency = BuildTriangleAdjacency(indices, vertexCount);
+    const auto& offsets = adjacency.offsets;
+    const auto& around = adjacency.triangles;
+
+    vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const auto& a = mesh.positions[indices[t * 3]];
+        normals[t] = glm::cross(mesh.positions[indices[t * 3 + 1]] - a, mesh.positions[indices[t * 3 + 2]] - a);
+    }
+
+    vector<bool> emitted(triangleCount, false);
+    vector<size_t> vertexMeshlet(vertexCount, detail::noMeshlet);
+    vector<size_t> candidateMeshlet(triangleCount, detail::noMeshlet);
+    vector<size_t> candidates;
+
+    vector<GLuint> reordered;
+    reordered.reserve(indices.size());
+    vector<Meshlet> meshlets;
+    size_t nextSeed = 0;
+
+    while (reordered.size() < indices.size())
+    {
+        // a triangle next to the last meshlet keeps neighbours together,
+        // otherwise the first one left
+        auto seed = detail::noMeshlet;
+        for (auto c : candidates)
+            if (!emitted[c])
+            {
+                seed = c;
+                break;
+            }
+
+        if (seed == detail::noMeshlet)
+        {
+            while (emitted[nextSeed])
+                ++nextSeed;
+            seed = nextSeed;
+        }
+
+        const auto id = meshlets.size();
+        meshlets.push_back(Meshlet{static_cast<uint32_t>(reordered.size()), 0, glm::vec3{0.0f}, 0.0f,
+                                   glm::vec3{0.0f}, 1.0f});
+        candidates.clear();
+
+        size_t triangles = 0;
+        size_t vertices = 0;
+        glm::vec3 normal{0.0f};
+
+        auto add = [&](size_t t)
+        {
+            emitted[t] = true;
+            normal += normals[t];
+            ++triangles;
+
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                const auto v = indices[t * 3 + corner];
+                reordered.push_back(v);
+
+                if (vertexMeshlet[v] == id)
+                    continue;
+
+                vertexMeshlet[v] = id;
+                ++vertices;
+
+                for (auto a = offsets[v]; a < offsets[v + 1]; ++a)
+                    if (!emitted[around[a]] && candidateMeshlet[around[a]] != id)
+                    {
+                        candidateMeshlet[around[a]] = id;
+                        candidates.push_back(around[a]);
+                    }
+            }
+        };
+
+        add(seed);
+
+        while (triangles < maxTriangles)
+        {
+            auto best = detail::noMeshlet;
+            size_t bestNew = 4;
+            auto bestDot = -numeric_limits<float>::max();
+            const auto length = glm::length(normal);
+            const auto direction = length > 0.0f ? normal / length : glm::vec3{0.0f};
+
+            // drops the emitted ones on the way
+            size_t kept = 0;
+            for (auto c : candidates)
+            {
+                if (emitted[c])
+                    continue;
+
+                candidates[kept++] = c;
+
+                size_t added = 0;
+                for (size_t corner = 0; corner < 3; ++corner)
+                    added += vertexMeshlet[indices[c * 3 + corner]] == id ? 0 : 1;
+
+                if (vertices + added > maxVertices)
+                    continue;
+
+                const auto n = glm::length(normals[c]);
+                const auto dot = n > 0.0f ? glm::dot(direction, normals[c] / n) : -1.0f;
+
+                if (added < bestNew || (added == bestNew && dot > bestDot))
+                {
+                    best = c;
+                    bestNew = added;
+                    bestDot = dot;
+                }
+            }
+
+            candidates.resize(kept);
+
+            if (best == detail::noMeshlet)
+                break;
+
+            add(best);
+        }
+
+        meshlets.back().indexCount = static_cast<uint32_t>(triangles * 3);
+    }
+
+    mesh.indices = move(reordered);
+
+    for (auto& meshlet : meshlets)
+        detail::ComputeMeshletBounds(meshlet, mesh.indices, mesh.positions);
+
+    return meshlets;
+}
+
+ostream& operator << (ostream& out, const MeshletCullStats& stats)
+{
+    const auto culled = stats.meshlets ?
+        double(stats.frustumCulled + stats.backfaceCulled) / stats.meshlets : 0.0;
+
+    return out << "{\"meshlets\": " << stats.meshlets
+               << ", \"frustum_culled\": " << stats.frustumCulled
+               << ", \"backface_culled\": " << stats.backfaceCulled
+               << ", \"culled\": " << culled
+               << ", \"draws\": " << stats.draws
+               << ", \"triangles\": " << stats.triangles << "}";
+}
+
+MeshletCullStats CullMeshlets(const vector<Meshlet>& meshlets, const glm::mat4& world,
+                              const glm::mat4& viewProjection, const glm::vec3& eye,
+                              GLenum indexType, MeshletDrawList& list)
+{
+    list.counts.clear();
+    list.offsets.clear();
+
+    MeshletCullStats stats{meshlets.size(), 0, 0, 0, 0};
+
+    // the planes in object space, so the meshlet bounds need no transform
+    const auto frustum = ExtractFrustum(viewProjection * world);
+
+    // the back face test holds for uniform scale, which keeps the cone
+    const auto objectEye4 = glm::inverse(world) * glm::vec4{eye, 1.0f};
+    const glm::vec3 objectEye{objectEye4.x, objectEye4.y, objectEye4.z};
+
+    const auto indexSize = IndexSize(indexType);
+
+    for (const auto& meshlet : meshlets)
+    {
+        if (!IntersectsSphere(frustum, meshlet.center, meshlet.radius))
+        {
+            ++stats.frustumCulled;
+            continue;
+        }
+
+        // every point of the sphere sees every triangle from behind
+        const auto view = meshlet.center - objectEye;
+        if (glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius)
+        {
+            ++stats.backfaceCulled;
+            continue;
+        }
+
+        stats.triangles += meshlet.indexCount / 3;
+
+        const auto offset = meshlet.firstIndex * indexSize;
+        if (!list.counts.empty() &&
+            reinterpret_cast<size_t>(list.offsets.back()) + list.counts.back() * indexSize == offset)
+        {
+            list.counts.back() += static_cast<GLsizei>(meshlet.indexCount);
+            continue;
+        }
+
+        list.counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+        list.offsets.push_back(reinterpret_cast<const void*>(offset));
+    }
+
+    stats.draws = list.counts.size();
+    return stats;
+}
+
+void DrawMeshlets(const TriangleBuffers& mesh, const MeshletDrawList& list)
+{
+    if (list.counts.empty())
+        return;
+
+    GLState::current().bindVertexArray(mesh.vao);
+    glMultiDrawElements(mesh.mode, list.counts.data(), mesh.indexType, list.offsets.data(),
+                        static_cast<GLsizei>(list.counts.size()));
+}
@@ -0,0 +1,66 @@
+#include "parallel.h"
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+unsigned HardwareThreads()
+{
+    return max(1u, thread::hardware_concurrency());
+}
+
+unsigned ParallelWorkers(size_t count, unsigned threads)
+{
+    if (threads == 0)
+        threads = HardwareThreads();
+
+    return static_cast<unsigned>(max<size_t>(1, min<size_t>(threads, count)));
+}
+
+void ParallelFor(size_t count, unsigned threads,
+                 const function<void(size_t begin, size_t end, unsigned worker)>& work)
+{
+    const auto workers = ParallelWorkers(count, threads);
+
+    auto range = [&](unsigned worker)
+    {
+        return make_pair(count * worker / workers, count * (worker + 1) / workers);
+    };
+
+    vector<exception_ptr> errors(workers);
+    vector<thread> pool;
+    pool.reserve(workers - 1);
+
+    for (unsigned worker = 1; worker < workers; ++worker)
+        pool.emplace_back([&, worker]()
+        {
+            try
+            {
+                const auto r = range(worker);
+                work(r.first, r.second, worker);
+            }
+            catch (...)
+            {
+                errors[worker] = current_exception();
+            }
+        });
+
+    try
+    {
+        const auto r = range(0);
+        work(r.first, r.second, 0);
+    }
+    catch (...)
+    {
+        errors[0] = current_exception();
+    }
+
+    for (auto& t : pool)
+        t.join();
+
+    for (auto& error : errors)
+        if (error)
+            rethrow_exception(error);
+}
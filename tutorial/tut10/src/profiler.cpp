@@ -0,0 +1,190 @@
+#include "profiler.h"
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+string GpuFrameProfile::path(size_t scope) const
+{
+    string result = scopes[scope].name;
+
+    for (auto parent = scopes[scope].parent; parent >= 0; parent = scopes[parent].parent)
+        result = string{scopes[parent].name} + "/" + result;
+
+    return result;
+}
+
+ostream& operator << (ostream& out, const GpuFrameProfile& profile)
+{
+    out << "GPU frame " << profile.frame << '\n';
+
+    for (const auto& scope : profile.scopes)
+        out << string(2 * (scope.depth + 1), ' ')
+            << scope.name << ": " << scope.durationMs << " ms"
+            << " (+" << scope.startMs << " ms)\n";
+
+    return out;
+}
+
+GpuProfiler::GpuProfiler(size_t latency)
+    : m_frames(latency)
+    , m_frameIndex{0}
+    , m_collected{0}
+    , m_stalls{0}
+    , m_inFrame{false}
+{
+    if (latency == 0)
+        throw invalid_argument{"GpuProfiler needs at least one frame in flight"};
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (auto& frame : m_frames)
+        if (!frame.queries.empty())
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (m_inFrame)
+        throw logic_error{"GpuProfiler::beginFrame called twice"};
+
+    // the slot still holds a frame the GPU hasn't finished: wait for that
+    // one only, the younger frames stay in flight
+    auto& frame = current();
+    if (frame.pending)
+        ++m_stalls;
+
+    for (; frame.pending; ++m_collected)
+        readBack(m_frames[m_collected % m_frames.size()], true);
+
+    frame.index = m_frameIndex;
+    frame.pending = true;
+    frame.used = 0;
+    frame.scopes.clear();
+
+    m_inFrame = true;
+    pushScope("frame");
+}
+
+void GpuProfiler::endFrame()
+{
+    popScope();
+
+    if (!m_stack.empty())
+        throw logic_error{"Unbalanced GPU profiler scopes"};
+
+    m_inFrame = false;
+    ++m_frameIndex;
+
+    collect(false);
+}
+
+void GpuProfiler::pushScope(const char* name)
+{
+    if (!m_inFrame)
+        throw logic_error{"GPU scope outside of a frame"};
+
+    auto& frame = current();
+    const auto depth = static_cast<int>(m_stack.size());
+    const auto parent = m_stack.empty() ? -1 : m_stack.back();
+    const auto begin = issueTimestamp(frame);
+
+    m_stack.push_back(static_cast<int>(frame.scopes.size()));
+    frame.scopes.push_back(Scope{name, parent, depth, begin, begin});
+}
+
+void GpuProfiler::popScope()
+{
+    if (m_stack.empty())
+        throw logic_error{"Unbalanced GPU profiler scopes"};
+
+    auto& frame = current();
+    frame.scopes[m_stack.back()].end = issueTimestamp(frame);
+    m_stack.pop_back();
+}
+
+bool GpuProfiler::nextResult(GpuFrameProfile& profile)
+{
+    if (m_results.empty())
+        return false;
+
+    profile = move(m_results.front());
+    m_results.pop_front();
+    return true;
+}
+
+void GpuProfiler::flush()
+{
+    collect(true);
+}
+
+GpuProfiler::Frame& GpuProfiler::current()
+{
+    return m_frames[m_frameIndex % m_frames.size()];
+}
+
+size_t GpuProfiler::issueTimestamp(Frame& frame)
+{
+    // the pool only grows, once warm a frame issues no glGenQueries
+    if (frame.used == frame.queries.size())
+    {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        if (!query)
+            throw runtime_error{"Unable to create timer query"};
+
+        frame.queries.push_back(query);
+    }
+
+    glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+    return frame.used++;
+}
+
+bool GpuProfiler::readBack(Frame& frame, bool wait)
+{
+    // timestamps land in order: when the last one is there, all of them are
+    if (!wait)
+    {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    vector<GLuint64> timestamps(frame.used);
+    for (size_t i = 0; i < frame.used; ++i)
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+    GpuFrameProfile profile;
+    profile.frame = frame.index;
+    profile.scopes.reserve(frame.scopes.size());
+
+    const auto origin = timestamps[frame.scopes[0].begin];
+    for (const auto& scope : frame.scopes)
+    {
+        const auto begin = timestamps[scope.begin];
+        const auto end = timestamps[scope.end];
+
+        profile.scopes.push_back(GpuScopeResult{
+            scope.name, scope.parent, scope.depth,
+            (begin - origin) / 1.0e6,
+            (end - begin) / 1.0e6
+        });
+    }
+
+    m_results.push_back(move(profile));
+    frame.pending = false;
+    return true;
+}
+
+void GpuProfiler::collect(bool wait)
+{
+    // frames complete in order, stop at the first one still in flight
+    for (; m_collected < m_frameIndex; ++m_collected)
+    {
+        auto& frame = m_frames[m_collected % m_frames.size()];
+        if (!readBack(frame, wait))
+            break;
+    }
+}
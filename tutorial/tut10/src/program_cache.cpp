@@ -0,0 +1,159 @@
+#include "program_cache.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace detail {
+
+const uint32_t cacheMagic = 0x42504c45; // "ELPB"
+const uint32_t cacheVersion = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+};
+
+// 64 bit FNV-1a, good enough to tell shader sets apart
+uint64_t Hash(uint64_t hash, const string& data)
+{
+    for (auto c : data)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+
+    // keep "ab" + "c" different from "a" + "bc"
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+
+    return hash;
+}
+
+string GetString(GLenum name)
+{
+    auto value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+} // detail
+
+ProgramCache::ProgramCache(const string& directory)
+    : m_directory{directory}
+    , m_driver{detail::GetString(GL_VENDOR) + '\n' +
+               detail::GetString(GL_RENDERER) + '\n' +
+               detail::GetString(GL_VERSION)}
+    , m_supported{false}
+    , m_stats{0, 0, 0, 0}
+{
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    m_supported = formats > 0;
+
+    mkdir(m_directory.c_str(), 0755);
+}
+
+string ProgramCache::key(const vector<ShaderSource>& sources) const
+{
+    auto hash = detail::Hash(0xcbf29ce484222325ull, m_driver);
+
+    for (const auto& s : sources)
+    {
+        hash = detail::Hash(hash, to_string(static_cast<int>(s.type)));
+        hash = detail::Hash(hash, s.source);
+    }
+
+    ostringstream key;
+    key << hex << setw(16) << setfill('0') << hash;
+    return key.str();
+}
+
+bool ProgramCache::load(GLuint program, const string& key)
+{
+    ifstream file{path(key), ios::binary};
+
+    detail::CacheHeader header;
+    if (!m_supported || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != detail::cacheMagic || header.version != detail::cacheVersion)
+    {
+        ++m_stats.misses;
+        return false;
+    }
+
+    // a truncated or corrupt entry must not make us allocate what its
+    // header claims
+    const auto start = file.tellg();
+    file.seekg(0, ios::end);
+    const auto remaining = static_cast<uint64_t>(file.tellg() - start);
+    file.seekg(start);
+
+    if (!file || header.length > remaining)
+    {
+        ++m_stats.misses;
+        return false;
+    }
+
+    vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        ++m_stats.misses;
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(), binary.size());
+
+    GLint linkResult = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkResult);
+
+    if (!linkResult)
+    {
+        ++m_stats.rejected;
+        return false;
+    }
+
+    ++m_stats.hits;
+    return true;
+}
+
+void ProgramCache::store(GLuint program, const string& key)
+{
+    if (!m_supported)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    const detail::CacheHeader header{detail::cacheMagic, detail::cacheVersion,
+                                     format, static_cast<uint32_t>(length)};
+
+    // write aside and rename, a crash never leaves a truncated entry behind
+    const auto target = path(key);
+    const auto temporary = target + ".tmp";
+    {
+        ofstream file{temporary, ios::binary | ios::trunc};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+
+        if (!file)
+            return;
+    }
+
+    if (rename(temporary.c_str(), target.c_str()) == 0)
+        ++m_stats.stored;
+}
+
+string ProgramCache::path(const string& key) const
+{
+    return m_directory + "/" + key + ".bin";
+}
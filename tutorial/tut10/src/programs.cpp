@@ -0,0 +1,117 @@
+#include "programs.h"
+#include "uniforms.h"
+#include "vertex_compression.h"
+
+using namespace std;
+
+namespace detail {
+
+// the blocks each program binds, see programs.h
+const initializer_list<UniformBlockBinding> triangleBlocks{{"Frame"_id, frameBinding}, {"Object"_id, objectBinding}};
+const initializer_list<UniformBlockBinding> instancedBlocks{{"Frame"_id, frameBinding}};
+const initializer_list<UniformBlockBinding> litBlocks{{"Frame"_id, frameBinding}, {"Object"_id, objectBinding}};
+const initializer_list<UniformBlockBinding> terrainBlocks{{"Frame"_id, frameBinding}, {"Chunk"_id, objectBinding}};
+
+} // detail
+
+TriangleProgram::TriangleProgram(const vector<ShaderSource>& sources, ProgramCache* cache)
+    : Program(sources, cache, detail::triangleBlocks)
+{
+}
+
+TriangleProgram::TriangleProgram(LinkedProgram&& linked)
+    : Program(move(linked), detail::triangleBlocks)
+{
+}
+
+InstancedProgram::InstancedProgram(const vector<ShaderSource>& sources, ProgramCache* cache)
+    : Program(sources, cache, detail::instancedBlocks)
+{
+}
+
+InstancedProgram::InstancedProgram(LinkedProgram&& linked)
+    : Program(move(linked), detail::instancedBlocks)
+{
+}
+
+LitProgram::LitProgram(const vector<ShaderSource>& sources, ProgramCache* cache)
+    : Program(sources, cache, detail::litBlocks)
+{
+}
+
+LitProgram::LitProgram(LinkedProgram&& linked)
+    : Program(move(linked), detail::litBlocks)
+{
+}
+
+TerrainProgram::TerrainProgram(const vector<ShaderSource>& sources, ProgramCache* cache)
+    : Program(sources, cache, detail::terrainBlocks)
+{
+}
+
+TerrainProgram::TerrainProgram(LinkedProgram&& linked)
+    : Program(move(linked), detail::terrainBlocks)
+{
+}
+
+vector<ShaderSource> TriangleGPUProgramSources()
+{
+    return {
+        LoadShaderSource(ShaderType::vertex  , "../../resources/tut10/shader.vs"),
+        LoadShaderSource(ShaderType::fragment, "../../resources/tut10/shader.fs")
+    };
+}
+
+vector<ShaderSource> InstancedGPUProgramSources()
+{
+    return {
+        LoadShaderSource(ShaderType::vertex  , "../../resources/tut10/instanced.vs"),
+        LoadShaderSource(ShaderType::fragment, "../../resources/tut10/shader.fs")
+    };
+}
+
+vector<ShaderSource> LitGPUProgramSources(NormalEncoding normals)
+{
+    const auto vertex = normals == NormalEncoding::octahedral
+            ? "../../resources/tut10/lit_oct.vs"
+            : "../../resources/tut10/lit.vs";
+
+    return {
+        LoadShaderSource(ShaderType::vertex  , vertex),
+        LoadShaderSource(ShaderType::fragment, "../../resources/tut10/shader.fs")
+    };
+}
+
+vector<ShaderSource> TerrainGPUProgramSources()
+{
+    return {
+        LoadShaderSource(ShaderType::vertex  , "../../resources/tut10/ground.vs"),
+        LoadShaderSource(ShaderType::fragment, "../../resources/tut10/ground.fs")
+    };
+}
+
+TriangleProgram CreateTriangleGPUProgram(ProgramCache* cache)
+{
+    return TriangleProgram{TriangleGPUProgramSources(), cache};
+}
+
+InstancedProgram CreateInstancedGPUProgram(ProgramCache* cache)
+{
+    return InstancedProgram{InstancedGPUProgramSources(), cache};
+}
+
+LitProgram CreateLitGPUProgram(NormalEncoding normals, ProgramCache* cache)
+{
+    return LitProgram{LitGPUProgramSources(normals), cache};
+}
+
+TerrainProgram CreateTerrainGPUProgram(ProgramCache* cache)
+{
+    return TerrainProgram{TerrainGPUProgramSources(), cache};
+}
+
+void LitProgram::setBounds(const MeshBounds& bounds)
+{
+    setUniform("boundsCenter"_id, glm::vec4{bounds.center, 0.0f});
+    setUniform("boundsExtent"_id, glm::vec4{bounds.extent, 0.0f});
+}
@@ -0,0 +1,174 @@
+#include "stream_buffer.h"
+#include "gl_state.h"
+#include "stopwatch.h"
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+ostream& operator << (ostream& out, const StreamStats& stats)
+{
+    return out << "{\"frames\": " << stats.frames
+               << ", \"waits\": " << stats.waits
+               << ", \"wait_ms\": " << stats.waitMs
+               << ", \"peak_bytes\": " << stats.peakBytes << "}";
+}
+
+StreamBuffer::StreamBuffer(size_t regionSize, size_t regions)
+    : m_buffer{0}
+    , m_mapping{nullptr}
+    , m_regionSize{regionSize}
+    , m_region{0}
+    , m_used{0}
+    , m_fences(regions, nullptr)
+    , m_stats{0, 0, 0.0, 0}
+{
+    if (regions == 0 || regionSize == 0)
+        throw invalid_argument{"StreamBuffer needs at least one non empty region"};
+
+    if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+        throw runtime_error{"Persistent buffers need GL_ARB_buffer_storage"};
+
+    glGenBuffers(1, &m_buffer);
+    if (!m_buffer)
+        throw runtime_error{"Unable to create Buffer"};
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const auto size = m_regionSize * regions;
+
+    GLState::current().bindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    m_mapping = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+
+    if (!m_mapping)
+    {
+        release();
+        throw runtime_error{"Unable to map the stream buffer"};
+    }
+}
+
+StreamBuffer::StreamBuffer(StreamBuffer&& rhs)
+    : m_buffer{rhs.m_buffer}
+    , m_mapping{rhs.m_mapping}
+    , m_regionSize{rhs.m_regionSize}
+    , m_region{rhs.m_region}
+    , m_used{rhs.m_used}
+    , m_fences{move(rhs.m_fences)}
+    , m_stats(rhs.m_stats)
+{
+    rhs.m_buffer = 0;
+    rhs.m_mapping = nullptr;
+}
+
+StreamBuffer& StreamBuffer::operator = (StreamBuffer&& rhs)
+{
+    release();
+
+    m_buffer = rhs.m_buffer;
+    m_mapping = rhs.m_mapping;
+    m_regionSize = rhs.m_regionSize;
+    m_region = rhs.m_region;
+    m_used = rhs.m_used;
+    m_fences = move(rhs.m_fences);
+    m_stats = rhs.m_stats;
+
+    rhs.m_buffer = 0;
+    rhs.m_mapping = nullptr;
+    return *this;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    release();
+}
+
+void StreamBuffer::nextFrame()
+{
+    if (m_fences[m_region])
+        glDeleteSync(m_fences[m_region]);
+
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_stats.peakBytes = max(m_stats.peakBytes, m_used);
+    ++m_stats.frames;
+
+    m_region = (m_region + 1) % m_fences.size();
+    m_used = 0;
+
+    waitRegion(m_region);
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size, size_t alignment)
+{
+    if (alignment == 0)
+        throw invalid_argument{"StreamBuffer alignment must not be zero"};
+
+    const auto base = m_region * m_regionSize;
+
+    // align the absolute offset, that is what glBindBufferRange checks
+    const auto offset = (base + m_used + alignment - 1) / alignment * alignment - base;
+    if (offset + size > m_regionSize)
+        throw out_of_range{"StreamBuffer region is full"};
+
+    m_used = offset + size;
+
+    return StreamAllocation{
+        m_mapping + base + offset,
+        static_cast<GLintptr>(base + offset),
+        size
+    };
+}
+
+void StreamBuffer::waitRegion(size_t region)
+{
+    auto& fence = m_fences[region];
+    if (!fence)
+        return;
+
+    // the common case: the GPU is already done and we don't block at all
+    auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        ++m_stats.waits;
+
+        Stopwatch waitTimer;
+        const GLuint64 oneMs = 1000000;
+        do
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, oneMs);
+        while (status == GL_TIMEOUT_EXPIRED);
+
+        m_stats.waitMs += waitTimer.elapsedMs();
+    }
+
+    if (status == GL_WAIT_FAILED)
+        throw runtime_error{"Waiting on the stream buffer fence failed"};
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::release()
+{
+    for (auto& fence : m_fences)
+        if (fence)
+            glDeleteSync(fence);
+
+    m_fences.clear();
+
+    if (!m_buffer)
+        return;
+
+    auto& state = GLState::current();
+
+    if (m_mapping)
+    {
+        state.bindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+
+    state.forgetBuffer(m_buffer);
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+    m_mapping = nullptr;
+}
@@ -0,0 +1,455 @@
+#include "terrain.h"
+#include "camera.h"
+#include "programs.h"
+#include "uniforms.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+using TerrainGridFormat = VertexFormat<Position3f>;
+
+// a hash of the lattice point in [0, 1]
+float TerrainLattice(int x, int z, unsigned seed)
+{
+    auto h = static_cast<uint32_t>(x) * 374761393u + static_cast<uint32_t>(z) * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return (h & 0xffffff) / float(0xffffff);
+}
+
+float TerrainValueNoise(float x, float z, unsigned seed)
+{
+    const auto x0 = static_cast<int>(floor(x));
+    const auto z0 = static_cast<int>(floor(z));
+    auto fx = x - x0;
+    auto fz = z - z0;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fz = fz * fz * (3.0f - 2.0f * fz);
+
+    const auto top = glm::mix(TerrainLattice(x0, z0, seed), TerrainLattice(x0 + 1, z0, seed), fx);
+    const auto bottom = glm::mix(TerrainLattice(x0, z0 + 1, seed), TerrainLattice(x0 + 1, z0 + 1, seed), fx);
+    return glm::mix(top, bottom, fz);
+}
+
+// closest point of the box within range of the eye
+bool WithinTerrainRange(const glm::vec3& low, const glm::vec3& high, const glm::vec3& eye, float range)
+{
+    const auto closest = glm::clamp(eye, low, high);
+    const auto d = closest - eye;
+    return glm::dot(d, d) <= range * range;
+}
+
+size_t CountQuadrants(uint32_t quadrants)
+{
+    return (quadrants & 1) + (quadrants >> 1 & 1) + (quadrants >> 2 & 1) + (quadrants >> 3 & 1);
+}
+
+void CheckTerrainSettings(const TerrainSettings& settings)
+{
+    if (settings.worldSize <= 0.0f || settings.heightScale < 0.0f)
+        throw invalid_argument{"The terrain needs a positive size"};
+
+    if (settings.gridSize < 2 || settings.gridSize % 2)
+        throw invalid_argument{"The terrain grid size must be even"};
+
+    if (settings.lodLevels < 1 || settings.lodLevels > 16)
+        throw invalid_argument{"The terrain needs 1 to 16 levels"};
+
+    if (settings.morphRatio <= 0.0f || settings.morphRatio >= 1.0f)
+        throw invalid_argument{"The terrain morph ratio must be in (0, 1)"};
+
+    if (settings.maxChunks == 0)
+        throw invalid_argument{"The terrain needs room for a chunk"};
+
+    // a leaf next to the next level must be done morphing before that level
+    // starts morphing itself, or the two grids don't meet
+    const auto leafSize = settings.worldSize / float(1 << (settings.lodLevels - 1));
+    if (leafSize * sqrt(2.0f) > (1.0f - settings.morphRatio) * settings.lodDistance)
+        throw invalid_argument{"The terrain lodDistance is too short for its leaf nodes"};
+}
+
+// (gridSize + 1)^2 vertices in grid cells, the indices of each quadrant one
+// after the other so a quarter of the grid is a single Submesh
+TriangleBuffers CreateTerrainGrid(int gridSize, vector<Submesh>& quadrants)
+{
+    const auto row = static_cast<GLuint>(gridSize + 1);
+    const auto half = gridSize / 2;
+
+    vector<TerrainGridFormat::Vertex> vertices;
+    vertices.reserve(row * row);
+    for (int z = 0; z <= gridSize; ++z)
+        for (int x = 0; x <= gridSize; ++x)
+            vertices.emplace_back(glm::vec3{float(x), 0.0f, float(z)});
+
+    vector<GLuint> indices;
+    indices.reserve(gridSize * gridSize * 6);
+    quadrants.clear();
+
+    for (int q = 0; q < 4; ++q)
+    {
+        const auto first = static_cast<uint32_t>(indices.size());
+        const auto x0 = (q & 1) * half;
+        const auto z0 = (q >> 1) * half;
+
+        // counter clockwise seen from above
+        for (int z = z0; z < z0 + half; ++z)
+            for (int x = x0; x < x0 + half; ++x)
+            {
+                const auto a = static_cast<GLuint>(z) * row + static_cast<GLuint>(x);
+                indices.insert(end(indices), {a, a + row, a + 1, a + 1, a + row, a + row + 1});
+            }
+
+        quadrants.push_back(Submesh{first, static_cast<uint32_t>(indices.size()) - first, 0});
+    }
+
+    return CreateMesh<TerrainGridFormat>(vertices, indices);
+}
+
+GLuint CreateHeightmapTexture(const Heightmap& heightmap)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    if (!texture)
+        throw runtime_error{"Unable to create Texture"};
+
+    const auto size = static_cast<GLsizei>(heightmap.size());
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, size, size);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RED, GL_FLOAT, heightmap.heights().data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+} // detail
+
+Heightmap::Heightmap(size_t size, vector<float> heights)
+    : m_size{size}
+    , m_heights{move(heights)}
+{
+    if (size < 2 || m_heights.size() != size * size)
+        throw invalid_argument{"A heightmap needs size * size heights"};
+}
+
+Heightmap GenerateHeightmap(size_t size, unsigned seed)
+{
+    if (size < 2)
+        throw invalid_argument{"A heightmap needs size * size heights"};
+
+    const int octaves = 8;
+    vector<float> heights(size * size);
+    auto low = numeric_limits<float>::max();
+    auto high = -numeric_limits<float>::max();
+
+    for (size_t z = 0; z < size; ++z)
+        for (size_t x = 0; x < size; ++x)
+        {
+            auto frequency = 4.0f / size;
+            auto amplitude = 1.0f;
+            auto h = 0.0f;
+
+            for (int octave = 0; octave < octaves; ++octave)
+            {
+                h += amplitude * detail::TerrainValueNoise(x * frequency, z * frequency, seed + octave);
+                frequency *= 2.0f;
+                amplitude *= 0.5f;
+            }
+
+            heights[z * size + x] = h;
+            low = min(low, h);
+            high = max(high, h);
+        }
+
+    // wide valleys and steep peaks
+    const auto scale = high > low ? 1.0f / (high - low) : 0.0f;
+    for (auto& h : heights)
+        h = pow((h - low) * scale, 1.5f);
+
+    return Heightmap{size, move(heights)};
+}
+
+ostream& operator << (ostream& out, const TerrainStats& stats)
+{
+    return out << "{\"nodes\": " << stats.nodes
+               << ", \"culled\": " << stats.culled
+               << ", \"chunks\": " << stats.chunks
+               << ", \"vertices\": " << stats.vertices
+               << ", \"triangles\": " << stats.triangles << "}";
+}
+
+Terrain::Terrain(const Heightmap& heightmap, const TerrainSettings& settings)
+    : m_settings{settings}
+    , m_stats{0, 0, 0, 0, 0}
+    , m_eye{0.0f}
+    , m_frustum{}
+    , m_cameraRevision{0}
+    , m_heightmapSize{heightmap.size()}
+    , m_texture{0}
+    , m_grid{0, 0, 0, 0, GL_TRIANGLES, GL_UNSIGNED_INT}
+{
+    detail::CheckTerrainSettings(settings);
+
+    // leaves from the samples under them, bilinear filtering stays within
+    // the two samples around a point
+    const auto size = heightmap.size();
+    const auto leaves = size_t{1} << (settings.lodLevels - 1);
+    m_levels.push_back(Level{leaves, vector<glm::vec2>(leaves * leaves)});
+
+    auto sample = [&](size_t node, bool upper)
+    {
+        const auto u = float(node + (upper ? 1 : 0)) / leaves * size - 0.5f;
+        const auto s = upper ? ceil(u) : floor(u);
+        return static_cast<size_t>(glm::clamp(s, 0.0f, float(size - 1)));
+    };
+
+    for (size_t z = 0; z < leaves; ++z)
+        for (size_t x = 0; x < leaves; ++x)
+        {
+            glm::vec2 range{numeric_limits<float>::max(), -numeric_limits<float>::max()};
+
+            for (auto sz = sample(z, false); sz <= sample(z, true); ++sz)
+                for (auto sx = sample(x, false); sx <= sample(x, true); ++sx)
+                {
+                    const auto h = heightmap.at(sx, sz) * settings.heightScale;
+                    range = glm::vec2{min(range.x, h), max(range.y, h)};
+                }
+
+            m_levels[0].heights[z * leaves + x] = range;
+        }
+
+    while (m_levels.back().nodes > 1)
+    {
+        const auto& child = m_levels.back();
+        Level parent{child.nodes / 2, vector<glm::vec2>(child.nodes * child.nodes / 4)};
+
+        for (size_t z = 0; z < parent.nodes; ++z)
+            for (size_t x = 0; x < parent.nodes; ++x)
+            {
+                auto range = child.heights[z * 2 * child.nodes + x * 2];
+                for (size_t q = 1; q < 4; ++q)
+                {
+                    const auto& h = child.heights[(z * 2 + (q >> 1)) * child.nodes + x * 2 + (q & 1)];
+                    range = glm::vec2{min(range.x, h.x), max(range.y, h.y)};
+                }
+
+                parent.heights[z * parent.nodes + x] = range;
+            }
+
+        m_levels.push_back(move(parent));
+    }
+
+    for (int level = 0; level < settings.lodLevels; ++level)
+        m_ranges.push_back(settings.lodDistance * float(1 << level));
+
+    m_selection.reserve(settings.maxChunks);
+    m_texture = detail::CreateHeightmapTexture(heightmap);
+    m_grid = detail::CreateTerrainGrid(settings.gridSize, m_quadrants);
+}
+
+Terrain::Terrain(Terrain&& rhs)
+    : m_settings{rhs.m_settings}
+    , m_levels{move(rhs.m_levels)}
+    , m_ranges{move(rhs.m_ranges)}
+    , m_selection{move(rhs.m_selection)}
+    , m_pending{move(rhs.m_pending)}
+    , m_stats{rhs.m_stats}
+    , m_eye{rhs.m_eye}
+    , m_frustum(rhs.m_frustum)
+    , m_cameraRevision{rhs.m_cameraRevision}
+    , m_heightmapSize{rhs.m_heightmapSize}
+    , m_texture{rhs.m_texture}
+    , m_grid(rhs.m_grid)
+    , m_quadrants{move(rhs.m_quadrants)}
+{
+    rhs.m_texture = 0;
+    rhs.m_grid = TriangleBuffers{0, 0, 0, 0, GL_TRIANGLES, GL_UNSIGNED_INT};
+}
+
+Terrain& Terrain::operator = (Terrain&& rhs)
+{
+    swap(m_settings, rhs.m_settings);
+    swap(m_levels, rhs.m_levels);
+    swap(m_ranges, rhs.m_ranges);
+    swap(m_selection, rhs.m_selection);
+    swap(m_pending, rhs.m_pending);
+    swap(m_stats, rhs.m_stats);
+    swap(m_eye, rhs.m_eye);
+    swap(m_frustum, rhs.m_frustum);
+    swap(m_cameraRevision, rhs.m_cameraRevision);
+    swap(m_heightmapSize, rhs.m_heightmapSize);
+    swap(m_texture, rhs.m_texture);
+    swap(m_grid, rhs.m_grid);
+    swap(m_quadrants, rhs.m_quadrants);
+    return *this;
+}
+
+Terrain::~Terrain()
+{
+    release();
+}
+
+void Terrain::release() noexcept
+{
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+
+    if (m_grid.vao)
+        DestroyTriangleBuffer(m_grid);
+
+    m_texture = 0;
+}
+
+float Terrain::nodeSize(int level) const noexcept
+{
+    return m_settings.worldSize / m_levels[level].nodes;
+}
+
+void Terrain::addChunk(int level, size_t x, size_t z, uint32_t quadrants)
+{
+    const auto size = nodeSize(level);
+    const auto origin = -0.5f * m_settings.worldSize;
+    const auto previous = level > 0 ? m_ranges[level - 1] : 0.0f;
+    const auto morphEnd = m_ranges[level];
+    const auto morphStart = previous + (morphEnd - previous) * (1.0f - m_settings.morphRatio);
+
+    const TerrainChunk chunk{glm::vec4{origin + x * size, origin + z * size, size, float(level)},
+                             glm::vec4{morphStart, morphEnd, 0.0f, 0.0f}};
+    m_selection.push_back(Selected{chunk, quadrants});
+}
+
+void Terrain::nodeBox(int level, size_t x, size_t z, glm::vec3& low, glm::vec3& high) const noexcept
+{
+    const auto size = nodeSize(level);
+    const auto origin = -0.5f * m_settings.worldSize;
+    const auto& heights = m_levels[level].heights[z * m_levels[level].nodes + x];
+
+    low = glm::vec3{origin + x * size, heights.x, origin + z * size};
+    high = glm::vec3{low.x + size, heights.y, low.z + size};
+}
+
+const TerrainStats& Terrain::select(const Camera& camera)
+{
+    if (camera.revision() == m_cameraRevision)
+        return m_stats;
+
+    m_cameraRevision = camera.revision();
+    m_eye = camera.position();
+    m_frustum = ExtractFrustum(static_cast<glm::mat4>(camera));
+    m_selection.clear();
+    m_pending.clear();
+    m_stats = TerrainStats{1, 0, 0, 0, 0};
+
+    glm::vec3 low, high;
+    nodeBox(m_settings.lodLevels - 1, 0, 0, low, high);
+
+    // the root is drawn however far, there is no coarser level
+    if (IntersectsBox(m_frustum, low, high))
+        m_pending.push_back(Pending{m_settings.lodLevels - 1, 0, 0});
+    else
+        ++m_stats.culled;
+
+    // queued nodes are visible and within their range, each ends as exactly
+    // one entry of the selection; refining one costs an entry per visible
+    // child and keeps its own only for the quarters it still draws
+    auto reserved = m_pending.size();
+
+    for (size_t i = 0; i < m_pending.size(); ++i)
+    {
+        const auto node = m_pending[i];
+        nodeBox(node.level, node.x, node.z, low, high);
+
+        if (node.level == 0 || !detail::WithinTerrainRange(low, high, m_eye, m_ranges[node.level - 1]))
+        {
+            addChunk(node.level, node.x, node.z, 0xf);
+            continue;
+        }
+
+        // children out of their range are left to this node
+        Pending children[4];
+        size_t visible = 0;
+        size_t culled = 0;
+        uint32_t quadrants = 0;
+
+        for (uint32_t q = 0; q < 4; ++q)
+        {
+            const Pending child{node.level - 1, node.x * 2 + (q & 1), node.z * 2 + (q >> 1)};
+            nodeBox(child.level, child.x, child.z, low, high);
+            ++m_stats.nodes;
+
+            if (!IntersectsBox(m_frustum, low, high))
+                ++culled;
+            else if (!detail::WithinTerrainRange(low, high, m_eye, m_ranges[child.level]))
+                quadrants |= 1u << q;
+            else
+                children[visible++] = child;
+        }
+
+        const auto cost = reserved - 1 + (quadrants ? 1 : 0) + visible;
+        if (cost > m_settings.maxChunks)
+        {
+            addChunk(node.level, node.x, node.z, 0xf);
+            continue;
+        }
+
+        if (quadrants)
+            addChunk(node.level, node.x, node.z, quadrants);
+
+        m_pending.insert(end(m_pending), children, children + visible);
+        m_stats.culled += culled;
+        reserved = cost;
+    }
+
+    const auto half = static_cast<size_t>(m_settings.gridSize / 2);
+    const auto full = (half * 2 + 1) * (half * 2 + 1);
+
+    for (const auto& selected : m_selection)
+    {
+        const auto quarters = detail::CountQuadrants(selected.quadrants);
+        m_stats.vertices += quarters == 4 ? full : quarters * (half + 1) * (half + 1);
+        m_stats.triangles += quarters * half * half * 2;
+    }
+
+    m_stats.chunks = m_selection.size();
+    return m_stats;
+}
+
+void Terrain::draw(TerrainProgram& program, UniformArena& chunks)
+{
+    const auto origin = -0.5f * m_settings.worldSize;
+
+    program.setUniform("terrain"_id, glm::vec4{origin, origin, m_settings.worldSize, m_settings.heightScale});
+    program.setUniform("terrainGrid"_id, glm::vec4{float(m_settings.gridSize), 1.0f / m_heightmapSize, 0.0f, 0.0f});
+    program.setUniform("heightmap"_id, GLint{0});
+    program.enable();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    for (const auto& selected : m_selection)
+    {
+        chunks.bind<TerrainChunk>(chunks.push(selected.chunk));
+
+        if (selected.quadrants == 0xf)
+        {
+            DrawMesh(m_grid);
+            continue;
+        }
+
+        for (uint32_t q = 0; q < 4; ++q)
+            if (selected.quadrants & (1u << q))
+                DrawSubmesh(m_grid, m_quadrants[q]);
+    }
+
+    program.disable();
+}
@@ -0,0 +1,169 @@
+#include "transform_hierarchy.h"
+#include "batch_math.h"
+#include "pipeline.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+const uint32_t noHierarchySlot = ~uint32_t{0};
+
+glm::mat4 ComposeLocal(const glm::vec3& position, float angle, const glm::vec3& axis, const glm::vec3& scale)
+{
+    return Pipeline{}.worldPos(position).rotate(angle, axis).scale(scale);
+}
+
+template<typename T>
+void InsertAt(vector<T>& items, uint32_t at, const T& item)
+{
+    items.insert(begin(items) + at, item);
+}
+
+} // detail
+
+TransformHierarchy::Node TransformHierarchy::add(const LocalTransform& local, Node parent)
+{
+    if (m_node.size() >= detail::noHierarchySlot - 1)
+        throw length_error{"Too many transform hierarchy nodes"};
+
+    const auto node = static_cast<Node>(m_slot.size());
+
+    if (parent == noParent)
+        insertSlot(static_cast<uint32_t>(m_node.size()), node, detail::noHierarchySlot, local);
+    else
+    {
+        const auto parentSlot = slot(parent);
+        insertSlot(m_end[parentSlot], node, parentSlot, local);
+    }
+
+    return node;
+}
+
+void TransformHierarchy::insertSlot(uint32_t at, Node node, uint32_t parent, const LocalTransform& local)
+{
+    // everything from at on moves one slot up, nothing when appending, as
+    // when a scene is built parent first
+    if (at < m_node.size())
+    {
+        for (auto& s : m_slot)
+            s += s >= at ? 1 : 0;
+
+        for (uint32_t s = 0; s < m_node.size(); ++s)
+        {
+            if (m_parent[s] != detail::noHierarchySlot && m_parent[s] >= at)
+                ++m_parent[s];
+
+            if (s >= at)
+                ++m_end[s];
+        }
+    }
+
+    // and the new node's ancestors grow by it
+    for (auto a = parent; a != detail::noHierarchySlot; a = m_parent[a])
+        ++m_end[a];
+
+    m_slot.push_back(at);
+
+    detail::InsertAt(m_node, at, node);
+    detail::InsertAt(m_parent, at, parent);
+    detail::InsertAt(m_end, at, at + 1);
+    detail::InsertAt(m_position, at, local.position);
+    detail::InsertAt(m_angle, at, local.angle);
+    detail::InsertAt(m_axis, at, local.axis);
+    detail::InsertAt(m_scale, at, local.scale);
+    detail::InsertAt(m_local, at, glm::mat4{1.0f});
+    detail::InsertAt(m_world, at, glm::mat4{1.0f});
+    detail::InsertAt(m_dirty, at, uint8_t{1});
+
+    m_dirtyNodes.push_back(node);
+}
+
+uint32_t TransformHierarchy::slot(Node node) const
+{
+    if (node >= m_slot.size())
+        throw out_of_range{"No such transform hierarchy node"};
+
+    return m_slot[node];
+}
+
+LocalTransform TransformHierarchy::local(Node node) const
+{
+    const auto s = slot(node);
+    return LocalTransform{m_position[s], m_angle[s], m_axis[s], m_scale[s]};
+}
+
+void TransformHierarchy::setLocal(Node node, const LocalTransform& local)
+{
+    const auto s = slot(node);
+
+    m_position[s] = local.position;
+    m_angle[s] = local.angle;
+    m_axis[s] = local.axis;
+    m_scale[s] = local.scale;
+
+    if (!m_dirty[s])
+    {
+        m_dirty[s] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+const glm::mat4& TransformHierarchy::world(Node node) const
+{
+    return m_world[slot(node)];
+}
+
+size_t TransformHierarchy::update()
+{
+    vector<uint32_t> roots(m_dirtyNodes.size());
+    transform(begin(m_dirtyNodes), end(m_dirtyNodes), begin(roots), [this](Node node) { return m_slot[node]; });
+    sort(begin(roots), end(roots));
+    m_dirtyNodes.clear();
+
+    // a dirty node inside a subtree already being redone is picked up there
+    size_t updated = 0;
+    uint32_t covered = 0;
+
+    for (auto root : roots)
+    {
+        if (root < covered)
+            continue;
+
+        updateRange(root, m_end[root]);
+        updated += m_end[root] - root;
+        covered = m_end[root];
+    }
+
+    return updated;
+}
+
+void TransformHierarchy::updateRange(uint32_t first, uint32_t end)
+{
+    // depth-first order: every parent is done before its children; the
+    // parent of first is outside the range and already up to date
+    for (auto s = first; s < end;)
+    {
+        const auto parent = m_parent[s];
+
+        // s and the leaf siblings right after it
+        auto run = s + 1;
+        while (run < end && m_end[run - 1] == run && m_parent[run] == parent)
+            ++run;
+
+        for (auto r = s; r < run; ++r)
+            if (m_dirty[r])
+            {
+                m_local[r] = detail::ComposeLocal(m_position[r], m_angle[r], m_axis[r], m_scale[r]);
+                m_dirty[r] = 0;
+            }
+
+        if (parent == detail::noHierarchySlot)
+            copy(begin(m_local) + s, begin(m_local) + run, begin(m_world) + s);
+        else
+            MultiplyMatrices(m_world[parent], &m_local[s], &m_world[s], run - s);
+
+        s = run;
+    }
+}
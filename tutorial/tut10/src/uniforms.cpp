@@ -0,0 +1,117 @@
+#include "uniforms.h"
+#include "gl_state.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace detail {
+
+GLuint CreateUniformBuffer(size_t size)
+{
+    GLuint ubo = 0;
+    glGenBuffers(1, &ubo);
+    if (!ubo)
+        throw runtime_error{"Unable to create Buffer"};
+
+    GLState::current().bindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+
+    return ubo;
+}
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t UniformOffsetAlignment()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return static_cast<size_t>(max(alignment, 1));
+}
+
+} // detail
+
+UniformBuffer::UniformBuffer(GLuint binding, size_t size)
+    : m_ubo{detail::CreateUniformBuffer(size)}
+    , m_binding{binding}
+    , m_size{size}
+{
+}
+
+UniformBuffer::UniformBuffer(UniformBuffer&& rhs)
+    : m_ubo{rhs.m_ubo}, m_binding{rhs.m_binding}, m_size{rhs.m_size}
+{
+    rhs.m_ubo = 0;
+}
+
+UniformBuffer& UniformBuffer::operator = (UniformBuffer&& rhs)
+{
+    swap(m_ubo, rhs.m_ubo);
+    m_binding = rhs.m_binding;
+    m_size = rhs.m_size;
+    return *this;
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    if (m_ubo)
+    {
+        GLState::current().forgetBuffer(m_ubo);
+        glDeleteBuffers(1, &m_ubo);
+    }
+}
+
+void UniformBuffer::update(const void* data, size_t size)
+{
+    if (size > m_size)
+        throw out_of_range{"Uniform data larger than the UniformBuffer"};
+
+    GLState::current().bindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+}
+
+void UniformBuffer::bind() const
+{
+    GLState::current().bindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_ubo);
+}
+
+UniformArena::UniformArena(GLuint binding, size_t capacity)
+    : m_stream{capacity}
+    , m_binding{binding}
+    , m_alignment{detail::UniformOffsetAlignment()}
+{
+}
+
+GLintptr UniformArena::push(const void* data, size_t size)
+{
+    auto block = m_stream.allocate(size, m_alignment);
+    memcpy(block.data, data, size);
+    return block.offset;
+}
+
+size_t UniformArena::stride(size_t size)
+{
+    return detail::AlignUp(size, detail::UniformOffsetAlignment());
+}
+
+void UniformArena::bind(GLintptr offset, size_t size) const
+{
+    GLState::current().bindBufferRange(GL_UNIFORM_BUFFER, m_binding, m_stream.buffer(), offset, size);
+}
+
+void UpdateFrameUniforms(UniformBuffer& frameUniforms, const Camera& camera, float time)
+{
+    const FrameUniforms frame{
+        camera.view(),
+        camera.projection(),
+        static_cast<glm::mat4>(camera),
+        glm::vec4{time, 0.0f, 0.0f, 0.0f}
+    };
+
+    frameUniforms.update(frame);
+    frameUniforms.bind();
+}
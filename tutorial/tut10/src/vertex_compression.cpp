@@ -0,0 +1,38 @@
+#include "vertex_compression.h"
+#include <limits>
+#include <ostream>
+
+using namespace std;
+
+MeshBounds ComputeBounds(const vector<glm::vec3>& positions)
+{
+    if (positions.empty())
+        return IdentityBounds();
+
+    auto lower = positions[0];
+    auto upper = positions[0];
+
+    for (const auto& p : positions)
+    {
+        lower = glm::min(lower, p);
+        upper = glm::max(upper, p);
+    }
+
+    auto extent = (upper - lower) * 0.5f;
+    for (int i = 0; i < 3; ++i)
+        extent[i] = max(extent[i], numeric_limits<float>::min());
+
+    return MeshBounds{(lower + upper) * 0.5f, extent};
+}
+
+MeshBounds IdentityBounds()
+{
+    return MeshBounds{glm::vec3{0.0f}, glm::vec3{1.0f}};
+}
+
+ostream& operator << (ostream& out, const EncodingError& error)
+{
+    return out << "{\"position\": " << error.position
+               << ", \"normal_degrees\": " << error.normalDegrees
+               << ", \"color\": " << error.color << "}";
+}
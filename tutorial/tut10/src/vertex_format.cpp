@@ -0,0 +1,120 @@
+#include "vertex_format.h"
+
+using namespace std;
+
+namespace detail {
+
+float SignNotZero(float value) noexcept
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+} // detail
+
+uint16_t FloatToHalf(float value) noexcept
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const auto exponent = static_cast<int32_t>((bits >> 23) & 0xffu);
+    auto mantissa = bits & 0x7fffffu;
+
+    // nan stays nan, inf and anything too large for a half become inf
+    if (exponent == 0xff)
+        return sign | 0x7c00u | (mantissa ? 0x200u : 0u);
+
+    const auto halfExponent = exponent - 127 + 15;
+    if (halfExponent >= 0x1f)
+        return sign | 0x7c00u;
+
+    if (halfExponent <= 0)
+    {
+        // subnormal half, or zero when even the implicit bit shifts out
+        if (halfExponent < -10)
+            return sign;
+
+        mantissa |= 0x800000u;
+        const auto shift = static_cast<uint32_t>(14 - halfExponent);
+        auto half = mantissa >> shift;
+        const auto rest = mantissa & ((1u << shift) - 1);
+        const auto halfway = 1u << (shift - 1);
+
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            ++half;
+
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // round to nearest even, a mantissa carry correctly bumps the exponent
+    auto half = static_cast<uint32_t>(halfExponent << 10) | (mantissa >> 13);
+    const auto rest = mantissa & 0x1fffu;
+
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        ++half;
+
+    return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t half) noexcept
+{
+    const auto sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    auto exponent = static_cast<int32_t>((half >> 10) & 0x1fu);
+    auto mantissa = static_cast<uint32_t>(half & 0x3ffu);
+
+    uint32_t bits;
+    if (exponent == 0x1f)
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | static_cast<uint32_t>(exponent - 15 + 127) << 23 | (mantissa << 13);
+    else if (mantissa == 0)
+        bits = sign;
+    else
+    {
+        // normalize the subnormal
+        exponent = 1;
+        while (!(mantissa & 0x400u))
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+
+        bits = sign | static_cast<uint32_t>(exponent - 15 + 127) << 23 | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+glm::vec2 OctahedralEncode(const glm::vec3& normal) noexcept
+{
+    const auto l1 = abs(normal.x) + abs(normal.y) + abs(normal.z);
+    if (l1 == 0.0f)
+        return glm::vec2{0.0f, 0.0f};
+
+    glm::vec2 encoded{normal.x / l1, normal.y / l1};
+
+    // the lower hemisphere folds over the diagonals
+    if (normal.z < 0.0f)
+        encoded = glm::vec2{
+            (1.0f - abs(encoded.y)) * detail::SignNotZero(encoded.x),
+            (1.0f - abs(encoded.x)) * detail::SignNotZero(encoded.y)
+        };
+
+    return encoded;
+}
+
+glm::vec3 OctahedralDecode(const glm::vec2& encoded) noexcept
+{
+    glm::vec3 normal{encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y)};
+
+    if (normal.z < 0.0f)
+    {
+        const auto x = normal.x;
+        normal.x = (1.0f - abs(normal.y)) * detail::SignNotZero(x);
+        normal.y = (1.0f - abs(x)) * detail::SignNotZero(normal.y);
+    }
+
+    return glm::normalize(normal);
+}
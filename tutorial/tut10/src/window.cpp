@@ -0,0 +1,273 @@
+#include "window.h"
+#include <stdexcept>
+#include <cstring>
+
+#ifdef ELICE_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+using namespace std;
+
+namespace detail {
+
+#ifdef ELICE_HEADLESS
+
+bool HasExtension(const char* extensions, const char* name)
+{
+    return extensions && strstr(extensions, name);
+}
+
+EGLDisplay GetHeadlessDisplay()
+{
+    // prefer the Mesa surfaceless platform, it needs neither X11 nor a GPU
+    auto clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+    if (getPlatformDisplay && HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        auto display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY)
+            return display;
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+void InitializeHeadless(Window& window)
+{
+    auto display = GetHeadlessDisplay();
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        throw runtime_error{"Unable to init EGL"};
+
+    window.eglDisplay = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw runtime_error{"Unable to bind the OpenGL API on EGL"};
+
+    const auto surfaceless = HasExtension(eglQueryString(display, EGL_EXTENSIONS),
+                                          "EGL_KHR_surfaceless_context");
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0)
+        throw runtime_error{"Unable to find an EGL config"};
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE,
+        EGL_NONE
+    };
+
+    auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+        throw runtime_error{"Unable to create EGL context"};
+
+    window.eglContext = context;
+
+    if (!surfaceless)
+    {
+        // the pbuffer is only there to make the context current, we draw in the FBO
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        auto surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE)
+            throw runtime_error{"Unable to create EGL pbuffer"};
+
+        window.eglSurface = surface;
+    }
+}
+
+void MakeHeadlessCurrent(Window& window)
+{
+    auto surface = window.eglSurface ? window.eglSurface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(window.eglDisplay, surface, surface, window.eglContext))
+        throw runtime_error{"Unable to make the EGL context current"};
+}
+
+void DestroyHeadless(Window& window)
+{
+    if (!window.eglDisplay)
+        return;
+
+    eglMakeCurrent(window.eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (window.eglSurface)
+        eglDestroySurface(window.eglDisplay, window.eglSurface);
+
+    if (window.eglContext)
+        eglDestroyContext(window.eglDisplay, window.eglContext);
+
+    eglTerminate(window.eglDisplay);
+}
+
+#else
+
+void InitializeHeadless(Window&)
+{
+    throw runtime_error{"Headless backend not available in this build"};
+}
+
+void MakeHeadlessCurrent(Window&)
+{
+}
+
+void DestroyHeadless(Window&)
+{
+}
+
+#endif
+
+void CreateRenderTarget(Window& window)
+{
+    glGenFramebuffers(1, &window.fbo);
+    glGenRenderbuffers(1, &window.colorBuffer);
+    glGenRenderbuffers(1, &window.depthBuffer);
+
+    if (!window.fbo || !window.colorBuffer || !window.depthBuffer)
+        throw runtime_error{"Unable to create the offscreen render target"};
+
+    glBindRenderbuffer(GL_RENDERBUFFER, window.colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, window.width, window.height);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, window.depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, window.width, window.height);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, window.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, window.colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, window.depthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        throw runtime_error{"Offscreen render target is incomplete"};
+}
+
+} // detail
+
+Window InitializeWindow(int width, int height, const std::string& title, WindowBackend backend)
+{
+    Window window = {backend, width, height,
+                     nullptr, nullptr,
+                     nullptr, nullptr, nullptr,
+                     0, 0, 0};
+
+    if (backend == WindowBackend::headless)
+    {
+        detail::InitializeHeadless(window);
+        return window;
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+        throw runtime_error{"Unable to init SDL2"};
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                        SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
+                        SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+    window.sdlWindow = SDL_CreateWindow(title.c_str(),
+                                        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                        width,
+                                        height,
+                                        SDL_WINDOW_OPENGL);
+
+    if (!window.sdlWindow)
+        throw runtime_error{"Unable to create SDL Window"};
+
+    return window;
+}
+
+void SetViewport(int width, int height)
+{
+    glClearColor(1.0f, 0.0f, 0.0f, 0.0f);
+    glViewport(0, 0, width, height);
+}
+
+void InitGrapics(Window& window)
+{
+    if (window.backend == WindowBackend::headless)
+    {
+        detail::MakeHeadlessCurrent(window);
+    }
+    else
+    {
+        window.sdlContext = SDL_GL_CreateContext(window.sdlWindow);
+        if (!window.sdlContext)
+            throw std::runtime_error{"Unable to create gl context"};
+    }
+
+    glewExperimental = GL_TRUE;
+    auto glewResult = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW probes GLX after loading the core entry points, there is none on EGL
+    if (window.backend == WindowBackend::headless && glewResult == GLEW_ERROR_NO_GLX_DISPLAY)
+        glewResult = GLEW_OK;
+#endif
+
+    if (glewResult != GLEW_OK)
+        throw runtime_error{"Unable to init GLEW"};
+
+    // glewExperimental can leave a spurious GL_INVALID_ENUM behind
+    glGetError();
+
+    if (window.backend == WindowBackend::headless)
+        detail::CreateRenderTarget(window);
+    else
+        SDL_GetWindowSize(window.sdlWindow, &window.width, &window.height);
+
+    SetViewport(window.width, window.height);
+}
+
+void SwapWindow(Window& window)
+{
+    if (window.backend == WindowBackend::headless)
+        glFlush();
+    else
+        SDL_GL_SwapWindow(window.sdlWindow);
+}
+
+void SetVSync(Window& window, bool enabled)
+{
+    // there is nothing to sync with offscreen
+    if (window.backend == WindowBackend::sdl)
+        SDL_GL_SetSwapInterval(enabled ? 1 : 0);
+}
+
+void DestroyWindow(Window& window)
+{
+    if (window.fbo)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &window.fbo);
+        glDeleteRenderbuffers(1, &window.colorBuffer);
+        glDeleteRenderbuffers(1, &window.depthBuffer);
+        window.fbo = window.colorBuffer = window.depthBuffer = 0;
+    }
+
+    if (window.backend == WindowBackend::headless)
+    {
+        detail::DestroyHeadless(window);
+        return;
+    }
+
+    if (window.sdlContext)
+        SDL_GL_DeleteContext(window.sdlContext);
+
+    if (window.sdlWindow)
+        SDL_DestroyWindow(window.sdlWindow);
+}